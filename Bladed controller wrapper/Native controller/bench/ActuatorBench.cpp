@@ -0,0 +1,116 @@
+// Times ActuatorBank against stepping a std::vector<Actuator>, for a farm of turbines with an actuator per blade,
+// and Actuator::outputSeries against output for a long recorded series of pitch demands.
+// Exits with 1 if they disagree, and is run as the ActuatorBench test with a short series.
+// Usage: ActuatorBench [turbines] [steps] [series length]
+
+#include "Actuator.hpp"
+#include "ActuatorBank.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    const size_t turbines = argc > 1 ? std::atoi(argv[1]) : 200;
+    const size_t steps = argc > 2 ? std::atoi(argv[2]) : 20000;
+    const size_t seriesLength = argc > 3 ? std::atoi(argv[3]) : 10000000;
+    const size_t count = 3 * turbines;
+    const double dt = 0.01;
+
+    std::vector<Actuator> actuators;
+    ActuatorBank bank;
+    for (size_t i = 0; i < count; i++)
+    {
+        // spread the parameters a little so that no coefficient is shared
+        double omega = 8.0 + 0.001 * i;
+        double gamma = 0.7 + 0.0001 * i;
+        actuators.push_back(Actuator(omega, gamma, dt));
+        bank.add(omega, gamma);
+    }
+
+    std::vector<double> input(count);
+    auto setInput = [&](size_t step)
+    {
+        for (size_t i = 0; i < count; i++)
+            input[i] = 0.1 * sin(0.01 * step + 0.1 * i);
+    };
+
+    using clock = std::chrono::steady_clock;
+    double scalarChecksum = 0;
+    clock::duration scalarTime{};
+    for (size_t step = 0; step < steps; step++)
+    {
+        setInput(step);
+        auto start = clock::now();
+        for (size_t i = 0; i < count; i++)
+            scalarChecksum += actuators[i].output(input[i]).x;
+        scalarTime += clock::now() - start;
+    }
+
+    double bankChecksum = 0;
+    clock::duration bankTime{};
+    for (size_t step = 0; step < steps; step++)
+    {
+        setInput(step);
+        auto start = clock::now();
+        bank.output(input.data(), dt);
+        bankTime += clock::now() - start;
+        for (size_t i = 0; i < count; i++)
+            bankChecksum += bank.state(i).x;
+    }
+
+    auto perStep = [&](clock::duration time)
+    {
+        return std::chrono::duration<double, std::nano>(time).count() / (steps * count);
+    };
+    printf("%zu actuators, %zu steps\n", count, steps);
+    printf("Actuator      %8.3f ns per actuator step\n", perStep(scalarTime));
+    printf("ActuatorBank  %8.3f ns per actuator step\n", perStep(bankTime));
+    printf("outputs %s\n", scalarChecksum == bankChecksum ? "identical" : "differ");
+
+    std::vector<double> series(seriesLength);
+    for (size_t i = 0; i < seriesLength; i++)
+        series[i] = 0.1 * sin(0.001 * i) + (i % 5000 < 2500 ? 0.05 : 0);
+    // a fixed worker count, so that the series is split into blocks whatever the machine, and a start away from
+    // rest, so that the correction of each block's start from the previous block is exercised
+    Actuator sequential(8.0, 0.7, dt);
+    Actuator parallel(8.0, 0.7, dt);
+    const ActuatorState initialState = { 0.08, -0.02, 0.3 };
+    const double initialInput = 0.06;
+    sequential.setState(initialState, initialInput);
+    parallel.setState(initialState, initialInput);
+    ThreadPool pool(3);
+
+    auto start = clock::now();
+    std::vector<ActuatorState> sequentialOutput(seriesLength);
+    for (size_t i = 0; i < seriesLength; i++)
+        sequentialOutput[i] = sequential.output(series[i]);
+    clock::duration sequentialTime = clock::now() - start;
+
+    start = clock::now();
+    std::vector<ActuatorState> parallelOutput = parallel.outputSeries(series, &pool);
+    clock::duration parallelTime = clock::now() - start;
+
+    double maxDifference = 0;
+    for (size_t i = 0; i < seriesLength; i++)
+    {
+        maxDifference = std::max(maxDifference, std::abs(sequentialOutput[i].x - parallelOutput[i].x));
+        maxDifference = std::max(maxDifference, std::abs(sequentialOutput[i].xdot - parallelOutput[i].xdot));
+        maxDifference = std::max(maxDifference, 1e-2 * std::abs(sequentialOutput[i].xdotdot - parallelOutput[i].xdotdot));
+    }
+    auto perSample = [&](clock::duration time)
+    {
+        return std::chrono::duration<double, std::nano>(time).count() / seriesLength;
+    };
+    printf("%zu sample series, %zu threads\n", seriesLength, pool.threadCount());
+    printf("output        %8.3f ns per sample\n", perSample(sequentialTime));
+    printf("outputSeries  %8.3f ns per sample\n", perSample(parallelTime));
+    printf("largest difference %g\n", maxDifference);
+
+    bool seriesAgree = maxDifference < 1e-10;
+    return scalarChecksum == bankChecksum && seriesAgree ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+// A stand-in for a Bladed style controller DLL, loaded by ControllerBench. Each call busy-waits for the number of
+// nanoseconds in the BENCH_DISCON_NS environment variable, 0 by default, to stand for the controller's own work,
+// then returns a fixed torque and slowly varying pitch demands.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+static long long workNanoseconds()
+{
+    static const long long result = [] {
+        const char* value = std::getenv("BENCH_DISCON_NS");
+        return value ? std::atoll(value) : 0;
+    }();
+    return result;
+}
+
+extern "C" void DISCON(float* avrSwap, int* aviFail, char*, char*, char* avcMsg)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() < workNanoseconds())
+        ;
+
+    // records are 1-based, see SwapRecords.hpp
+    float time = avrSwap[1];
+    float pitch = 0.1f + 0.01f * std::sin(time);
+    avrSwap[41] = pitch;
+    avrSwap[42] = pitch + 0.001f;
+    avrSwap[43] = pitch + 0.002f;
+    avrSwap[44] = pitch;
+    avrSwap[46] = 40000.0f;
+    avrSwap[47] = 0.0f;
+    *aviFail = 0;
+    avcMsg[0] = 0;
+}
@@ -0,0 +1,429 @@
+/* Times BladedController steps without OrcaFlex. The wrapper library is loaded as OrcaFlex would load it, and
+   given this program as its OrcFxAPI: the C_ functions below stand in for a model with one turbine, answer the
+   data and tag queries made at initialisation and return synthetic results, busy-waiting for a set time per
+   results call to stand for OrcFxAPI's own cost. DISCON is BenchDiscon, whose work is set by BENCH_DISCON_NS.
+
+   A step is the torque and pitch calculations of one time step, repeated calls times each. Steps are timed for
+   1 to 3 blades with common and individual pitch control, with and without the actuator, and each is timed
+   with DISCON called in process and in a DisconHost process, as selected by the ControllerHost tag, so that
+   the cost of the round trip to the host can be read off.
+
+   Usage: ControllerBench [--steps n] [--api-ns ns] [--value-ns ns] [--calls n] */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwctype>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dlfcn.h>
+#include "OrcFxAPI.h"
+
+using namespace Orcina;
+
+// the cost of one C_GetMultipleTimeHistories call and of each value it returns
+static long long apiCallNanoseconds = 1000;
+static long long apiValueNanoseconds = 50;
+
+static bool errorRecorded = false;
+
+static void busyWait(long long nanoseconds)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() < nanoseconds)
+        ;
+}
+
+static std::wstring lower(std::wstring value)
+{
+    for (wchar_t& c : value)
+        c = std::towlower(c);
+    return value;
+}
+
+struct StubObject
+{
+    std::wstring name;
+    int type;
+    std::map<std::wstring, double> doubles; // data names in lower case, as OrcaFlex ignores case
+    std::map<std::wstring, int> integers;
+    std::map<std::wstring, std::wstring> strings;
+    std::map<std::wstring, std::wstring> tags;
+    std::map<std::wstring, INT_PTR> namedValues;
+};
+
+struct StubModel
+{
+    StubObject model{ L"Model", 0 };
+    StubObject general{ L"General", otGeneral };
+    StubObject environment{ L"Environment", otEnvironment };
+    StubObject turbine{ L"Turbine1", otTurbine };
+    uint64_t fetches = 0;
+};
+
+static StubModel* stub = nullptr;
+
+static TOrcFxAPIHandle handle(StubObject& object)
+{
+    return reinterpret_cast<TOrcFxAPIHandle>(&object);
+}
+
+static StubObject& object(TOrcFxAPIHandle handle)
+{
+    return *reinterpret_cast<StubObject*>(handle);
+}
+
+// OrcFxAPI, as far as the wrapper uses it
+
+extern "C"
+{
+
+void __stdcall C_GetModelHandle(TOrcFxAPIHandle, TOrcFxAPIHandle* lpModelHandle, int* lpStatus)
+{
+    *lpModelHandle = handle(stub->model);
+    *lpStatus = stOK;
+}
+
+void __stdcall C_GetModelProperty(TOrcFxAPIHandle, int PropertyId, void* lpValue, int* lpStatus)
+{
+    *lpStatus = stOK;
+    if (PropertyId == propGeneralHandle)
+        *static_cast<TOrcFxAPIHandle*>(lpValue) = handle(stub->general);
+    else if (PropertyId == propEnvironmentHandle)
+        *static_cast<TOrcFxAPIHandle*>(lpValue) = handle(stub->environment);
+    else
+        *lpStatus = stValueNotAvailable;
+}
+
+void __stdcall C_GetSimulationTimeStatus(TOrcFxAPIHandle, TSimulationTimeStatus* lpSimulationTimeStatus, int* lpStatus)
+{
+    *lpSimulationTimeStatus = { 0, 1e6, 0 };
+    *lpStatus = stOK;
+}
+
+void __stdcall C_ObjectCalledW(TOrcFxAPIHandle, LPCWSTR lpObjectName, TObjectInfoW* lpObjectInfo, int* lpStatus)
+{
+    for (StubObject* candidate : { &stub->general, &stub->environment, &stub->turbine })
+        if (lower(candidate->name) == lower(lpObjectName))
+        {
+            lpObjectInfo->ObjectHandle = handle(*candidate);
+            lpObjectInfo->ObjectType = candidate->type;
+            *lpStatus = stOK;
+            return;
+        }
+    *lpStatus = stInvalidHandle;
+}
+
+void __stdcall C_GetDataTypeW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpDataName, int* lpDataType, int* lpStatus)
+{
+    StubObject& data = object(ObjectHandle);
+    std::wstring name = lower(lpDataName);
+    *lpStatus = stOK;
+    if (data.doubles.count(name))
+        *lpDataType = dtDouble;
+    else if (data.integers.count(name))
+        *lpDataType = dtInteger;
+    else if (data.strings.count(name) || name == L"name")
+        *lpDataType = dtString;
+    else
+        *lpStatus = stInvalidDataName;
+}
+
+void __stdcall C_GetDataDoubleW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpDataName, int, double* lpData, int* lpStatus)
+{
+    StubObject& data = object(ObjectHandle);
+    auto value = data.doubles.find(lower(lpDataName));
+    if (value == data.doubles.end())
+    {
+        *lpStatus = stInvalidDataName;
+        return;
+    }
+    *lpData = value->second;
+    *lpStatus = stOK;
+}
+
+void __stdcall C_GetDataIntegerW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpDataName, int, int* lpData, int* lpStatus)
+{
+    StubObject& data = object(ObjectHandle);
+    auto value = data.integers.find(lower(lpDataName));
+    if (value == data.integers.end())
+    {
+        *lpStatus = stInvalidDataName;
+        return;
+    }
+    *lpData = value->second;
+    *lpStatus = stOK;
+}
+
+int __stdcall C_GetDataStringW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpDataName, int, LPWSTR lpData, int* lpStatus)
+{
+    StubObject& data = object(ObjectHandle);
+    std::wstring name = lower(lpDataName);
+    std::wstring value;
+    if (name == L"name")
+        value = data.name;
+    else if (data.strings.count(name))
+        value = data.strings[name];
+    else
+    {
+        *lpStatus = stInvalidDataName;
+        return 0;
+    }
+    if (lpData)
+        wcscpy(lpData, value.c_str());
+    *lpStatus = stOK;
+    return static_cast<int>(value.size() + 1);
+}
+
+int __stdcall C_GetTagW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpName, LPWSTR lpValue, int* lpStatus)
+{
+    StubObject& data = object(ObjectHandle);
+    auto value = data.tags.find(lpName);
+    if (value == data.tags.end())
+    {
+        *lpStatus = stTagNotFound;
+        return 0;
+    }
+    if (lpValue)
+        wcscpy(lpValue, value->second.c_str());
+    *lpStatus = stOK;
+    return static_cast<int>(value->second.size() + 1);
+}
+
+INT_PTR __stdcall C_GetNamedValueW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpName, int* lpStatus)
+{
+    *lpStatus = stOK;
+    return object(ObjectHandle).namedValues[lpName];
+}
+
+void __stdcall C_SetNamedValueW(TOrcFxAPIHandle ObjectHandle, LPCWSTR lpName, INT_PTR Value, int* lpStatus)
+{
+    object(ObjectHandle).namedValues[lpName] = Value;
+    *lpStatus = stOK;
+}
+
+void __stdcall C_GetUnitsConversionFactorW(TOrcFxAPIHandle, LPCWSTR, double* lpConversionFactor, int* lpStatus)
+{
+    *lpConversionFactor = 1;
+    *lpStatus = stOK;
+}
+
+void __stdcall C_GetVarIDW(TOrcFxAPIHandle, LPCWSTR lpVarName, int* lpVarID, int* lpStatus)
+{
+    *lpVarID = static_cast<int>(std::hash<std::wstring>()(lpVarName) % 1000);
+    *lpStatus = stOK;
+}
+
+void __stdcall C_GetMultipleTimeHistoriesW(int Count, const TTimeHistorySpecificationW* lpSpecification,
+    const TPeriod*, double* lpValues, int* lpStatus)
+{
+    busyWait(apiCallNanoseconds + Count * apiValueNanoseconds);
+    double phase = 0.01 * static_cast<double>(stub->fetches++);
+    for (int i = 0; i < Count; i++)
+        lpValues[i] = 1000 * std::sin(phase + lpSpecification[i].VarID);
+    *lpStatus = stOK;
+}
+
+double __stdcall OrcinaDefaultReal()
+{
+    return -1e307;
+}
+
+void __stdcall C_ExternalFunctionPrintW(LPCWSTR lpText, int* lpStatus)
+{
+    printf("%ls", lpText);
+    *lpStatus = stOK;
+}
+
+void __stdcall C_RecordExternalFunctionErrorW(TExternalFunctionInfoW*, LPCWSTR lpErrorString, int* lpStatus)
+{
+    fprintf(stderr, "%ls\n", lpErrorString);
+    errorRecorded = true;
+    *lpStatus = stOK;
+}
+
+int __stdcall C_GetLastErrorStringW(LPWSTR lpErrorString)
+{
+    const wchar_t error[] = L"stub OrcFxAPI error";
+    if (lpErrorString)
+        wcscpy(lpErrorString, error);
+    return static_cast<int>(std::size(error));
+}
+
+}
+
+// the wrapper, loaded as OrcaFlex loads an external function library
+
+typedef void (__stdcall *InitializeOrcFxAPIProc)(HMODULE);
+typedef void (__stdcall *ExternalFunctionProc)(TExtFnInfoW&);
+
+struct Scenario
+{
+    int bladeCount;
+    bool common;
+    bool actuator;
+    bool host;
+};
+
+static const double timeStep = 0.01;
+
+class Turbine
+{
+public:
+    Turbine(ExternalFunctionProc controller, const Scenario& scenario, const std::wstring& directory)
+        : controller(controller), directory(directory), modelFileName(directory + L"/ControllerBench.dat")
+    {
+        stub = &model;
+        model.general.doubles[L"implicitconstanttimestep"] = timeStep;
+        model.general.doubles[L"northdirection"] = 90;
+        model.turbine.strings[L"pitchcontrolmode"] = scenario.common ? L"Common" : L"Individual";
+        model.turbine.integers[L"bladecount"] = scenario.bladeCount;
+        model.turbine.tags[L"ControllerDLL"] = L"BenchDiscon.dll";
+        model.turbine.tags[L"ControllerDLLCanBeShared"] = L"True";
+        model.turbine.tags[L"UseActuator"] = scenario.actuator ? L"True" : L"False";
+        model.turbine.tags[L"ActuatorOmega"] = L"12";
+        model.turbine.tags[L"ActuatorGamma"] = L"0.7";
+        if (scenario.host)
+        {
+            std::string hostFileName = DISCON_HOST_EXECUTABLE;
+            model.turbine.tags[L"ControllerHost"] = std::wstring(hostFileName.begin(), hostFileName.end());
+        }
+
+        icd.Size = sizeof(icd);
+        icd.GeneratorAngVel = 120;
+        icd.MainShaftAngVel = 1.2;
+        icd.BladeCount = scenario.bladeCount;
+        icd.HorizontalHubWindSpeed = 11;
+        icd.HubRelativeWindVelocity = { 11, 0, 0 };
+        icd.TurbineOrientation = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+
+        call(eaInitialise, 0, L"GeneratorTorqueController", torqueData, true);
+        call(eaInitialise, 0, L"PitchController", pitchData, true);
+    }
+
+    ~Turbine()
+    {
+        call(eaFinalise, time, L"GeneratorTorqueController", torqueData, true);
+        call(eaFinalise, time, L"PitchController", pitchData, true);
+        stub = nullptr;
+    }
+
+    void step(int calls)
+    {
+        time += timeStep;
+        for (int i = 0; i < calls; i++)
+        {
+            call(eaCalculate, time, L"GeneratorTorqueController", torqueData, i == 0);
+            call(eaCalculate, time, L"PitchController", pitchData, i == 0);
+        }
+    }
+private:
+    void call(int action, double simulationTime, const wchar_t* dataName, void*& data, bool newTimeStep)
+    {
+        TExtFnInfoW info{
+            .Size = sizeof(TExtFnInfoW),
+            .Action = action,
+            .SimulationTime = simulationTime,
+            .Value = 0,
+            .Successful = TRUE,
+            .ObjectHandle = handle(model.turbine),
+            .lpObjectExtra = nullptr,
+            .lpObjectParameters = nullptr,
+            .lpWorkingDataHandle = nullptr,
+            .lpData = data,
+            .lpDataSourceName = nullptr,
+            .lpStateData = nullptr,
+            .LengthOfStateData = 0,
+            .lpDataName = dataName,
+            .lpInstantaneousCalculationData = &icd,
+            .lpModelDirectory = directory.c_str(),
+            .UpdateDuringStatics = FALSE,
+            .lpLogData = nullptr,
+            .LengthOfLogData = 0,
+            .ResultID = 0,
+            .NewTimeStep = newTimeStep,
+            .lpStructValue = pitch,
+            .ModelHandle = handle(model.model),
+            .lpModelFileName = modelFileName.c_str(),
+            .DataObjectHandle = handle(model.turbine),
+            .CanResumeSimulation = FALSE
+        };
+        controller(info);
+        data = info.lpData;
+    }
+private:
+    ExternalFunctionProc controller;
+    std::wstring directory;
+    std::wstring modelFileName;
+    StubModel model;
+    TTurbineInstantaneousCalculationData icd = {};
+    TScalarStructValue pitch[3] = {};
+    void* torqueData = nullptr;
+    void* pitchData = nullptr;
+    double time = 0;
+};
+
+int main(int argc, char* argv[])
+{
+    int steps = 200000;
+    int calls = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc)
+            steps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--api-ns") == 0 && i + 1 < argc)
+            apiCallNanoseconds = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--value-ns") == 0 && i + 1 < argc)
+            apiValueNanoseconds = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--calls") == 0 && i + 1 < argc)
+            calls = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "Usage: ControllerBench [--steps n] [--api-ns ns] [--value-ns ns] [--calls n]\n");
+            return 1;
+        }
+    }
+
+    void* wrapper = dlopen(CONTROLLER_WRAPPER_LIBRARY, RTLD_NOW | RTLD_LOCAL);
+    if (!wrapper)
+    {
+        fprintf(stderr, "Could not load %s, %s\n", CONTROLLER_WRAPPER_LIBRARY, dlerror());
+        return 1;
+    }
+    auto initializeOrcFxAPI = reinterpret_cast<InitializeOrcFxAPIProc>(dlsym(wrapper, "InitializeOrcFxAPI"));
+    auto controller = reinterpret_cast<ExternalFunctionProc>(dlsym(wrapper, "BladedController"));
+    initializeOrcFxAPI(dlopen(nullptr, RTLD_NOW)); // this program is the OrcFxAPI
+
+    std::string directory = BENCH_DISCON_DIRECTORY;
+    printf("%d steps of %d calls, OrcFxAPI results %lld ns + %lld ns per value, DISCON %s ns\n", steps, calls,
+        apiCallNanoseconds, apiValueNanoseconds, getenv("BENCH_DISCON_NS") ? getenv("BENCH_DISCON_NS") : "0");
+    printf("%-7s %-11s %-9s %12s %12s\n", "blades", "control", "actuator", "ns/step", "host ns/step");
+    for (bool actuator : { false, true })
+        for (bool common : { true, false })
+            for (int bladeCount = 1; bladeCount <= 3; bladeCount++)
+            {
+                double nanosecondsPerStep[2];
+                for (bool host : { false, true })
+                {
+                    Scenario scenario{ bladeCount, common, actuator, host };
+                    Turbine turbine(controller, scenario, std::wstring(directory.begin(), directory.end()));
+                    for (int i = 0; i < steps / 10; i++)
+                        turbine.step(calls);
+
+                    auto start = std::chrono::steady_clock::now();
+                    for (int i = 0; i < steps; i++)
+                        turbine.step(calls);
+                    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                    nanosecondsPerStep[host] = nanoseconds / steps;
+                    if (errorRecorded)
+                        return 1;
+                }
+                printf("%-7d %-11s %-9s %12.1f %12.1f\n", bladeCount, common ? "common" : "individual", actuator ? "on" : "off",
+                    nanosecondsPerStep[false], nanosecondsPerStep[true]);
+            }
+    return 0;
+}
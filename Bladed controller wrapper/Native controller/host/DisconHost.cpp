@@ -0,0 +1,192 @@
+/* Host process for running Bladed style controller DLLs outside OrcaFlex. Launched by the wrapper with the
+   name of a shared memory block, its slot count and the wrapper's process ID. Each slot is served on its own
+   thread, which loads the DLL named by the attach command and then calls DISCON on request. The host exits
+   when the wrapper asks it to, or when the wrapper process goes away.
+
+   Usage: DisconHost <block name> <slot count> <parent process ID> */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "DisconHost.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+typedef HMODULE LibraryHandle;
+#else
+typedef void* LibraryHandle;
+#define __cdecl
+#endif
+
+typedef void (__cdecl *discon_func)(float*, int*, char*, char*, char*);
+
+// how often an idle slot thread checks that the wrapper is still alive
+static const int idleCheckMilliseconds = 1000;
+
+class ParentProcess
+{
+public:
+    ParentProcess(unsigned long pid) : pid(pid)
+    {
+#ifdef _WIN32
+        handle = OpenProcess(SYNCHRONIZE, FALSE, pid);
+#endif
+    }
+    ~ParentProcess()
+    {
+#ifdef _WIN32
+        if (handle)
+            CloseHandle(handle);
+#endif
+    }
+    bool alive() const
+    {
+#ifdef _WIN32
+        return handle && WaitForSingleObject(handle, 0) != WAIT_OBJECT_0;
+#else
+        return getppid() == static_cast<pid_t>(pid);
+#endif
+    }
+private:
+    unsigned long pid;
+#ifdef _WIN32
+    HANDLE handle = nullptr;
+#endif
+};
+
+static void setMessage(DisconHostSlot& slot, const std::string& msg)
+{
+    slot.aviFail = -1;
+    snprintf(slot.avcMsg, STRINGLENGTH, "%s", msg.c_str());
+}
+
+static LibraryHandle loadLibrary(DisconHostSlot& slot, discon_func& discon)
+{
+#ifdef _WIN32
+    int length = MultiByteToWideChar(CP_UTF8, 0, slot.dllFileName, -1, nullptr, 0);
+    std::wstring fileName(length, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, slot.dllFileName, -1, fileName.data(), length);
+    LibraryHandle lib = LoadLibraryW(fileName.c_str());
+    if (!lib)
+    {
+        setMessage(slot, std::string("Could not load DLL ") + slot.dllFileName + ", error code " + std::to_string(GetLastError()) + ".");
+        return nullptr;
+    }
+    discon = reinterpret_cast<discon_func>(GetProcAddress(lib, "DISCON"));
+#else
+    LibraryHandle lib = dlopen(slot.dllFileName, RTLD_NOW | RTLD_LOCAL);
+    if (!lib)
+    {
+        setMessage(slot, std::string("Could not load DLL ") + slot.dllFileName + ", " + dlerror() + ".");
+        return nullptr;
+    }
+    discon = reinterpret_cast<discon_func>(dlsym(lib, "DISCON"));
+#endif
+    if (!discon)
+        setMessage(slot, std::string("Could not import function named DISCON from DLL ") + slot.dllFileName + ".");
+    return lib;
+}
+
+static void freeLibrary(LibraryHandle lib)
+{
+    if (!lib)
+        return;
+#ifdef _WIN32
+    FreeLibrary(lib);
+#else
+    dlclose(lib);
+#endif
+}
+
+static void serveSlot(DisconHostBlock* block, const std::string& blockName, uint32_t slotIndex, const ParentProcess* parent)
+{
+    DisconHostSlot& slot = block->slots[slotIndex];
+    DisconHostSignal request(slot.request, slot.hostWaiting, disconHostEventName(blockName, slotIndex, "request"));
+    DisconHostSignal response(slot.response, slot.clientWaiting, disconHostEventName(blockName, slotIndex, "response"));
+
+    LibraryHandle lib = nullptr;
+    discon_func discon = nullptr;
+    // start from the last completed request, the wrapper may already have posted the next one
+    uint32_t last = slot.response.load(std::memory_order_acquire);
+    while (true)
+    {
+        if (!request.waitChange(last, idleCheckMilliseconds))
+        {
+            if (block->shutdown.load() || !parent->alive())
+                break;
+            continue;
+        }
+        if (block->shutdown.load())
+            break;
+        last = slot.request.load(std::memory_order_acquire);
+
+        switch (static_cast<DisconHostCommand>(slot.command))
+        {
+        case DisconHostCommand::attach:
+            freeLibrary(lib);
+            slot.aviFail = 0;
+            lib = loadLibrary(slot, discon);
+            break;
+        case DisconHostCommand::call:
+            if (discon)
+                discon(slot.avrSwap, &slot.aviFail, slot.accInfile, slot.avcOutfile, slot.avcMsg);
+            else
+                setMessage(slot, "No controller DLL is attached.");
+            break;
+        case DisconHostCommand::detach:
+            freeLibrary(lib);
+            lib = nullptr;
+            discon = nullptr;
+            break;
+        default:
+            break;
+        }
+
+        response.post(last);
+    }
+    freeLibrary(lib);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        fprintf(stderr, "Usage: DisconHost <block name> <slot count> <parent process ID>\n");
+        return 1;
+    }
+
+    try
+    {
+        std::string blockName = argv[1];
+        uint32_t slotCount = static_cast<uint32_t>(strtoul(argv[2], nullptr, 10));
+        ParentProcess parent(strtoul(argv[3], nullptr, 10));
+
+        SharedMemoryBlock memory(blockName);
+        DisconHostBlock* block = static_cast<DisconHostBlock*>(memory.data());
+        if (block->version != disconHostVersion || block->slotCount != slotCount)
+            throw std::runtime_error("Shared memory block does not match this host.");
+
+        std::vector<std::thread> threads;
+        for (uint32_t slotIndex = 0; slotIndex < slotCount; slotIndex++)
+            threads.emplace_back(serveSlot, block, blockName, slotIndex, &parent);
+        for (auto& thread : threads)
+            thread.join();
+    }
+    catch (const std::exception& exc)
+    {
+        fprintf(stderr, "DisconHost: %s\n", exc.what());
+        return 1;
+    }
+    return 0;
+}
@@ -1,5 +1,13 @@
 #pragma once
 
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
 struct ActuatorState
 {
     double x;
@@ -7,17 +15,56 @@ struct ActuatorState
     double xdotdot;
 };
 
+// the exact discrete transition of an actuator over a time step dt, for an input that varies linearly over the step
+struct ActuatorCoefficients
+{
+    double dt;
+    double xFromX;
+    double xFromXdot;
+    double xFromUdot;
+    double xFromU;
+    double xdotFromX; // the x terms of xdot and xdotdot apply to x - uprev
+    double xdotFromXdot;
+    double xdotFromUdot;
+    double xdotdotFromX;
+    double xdotdotFromXdot;
+    double xdotdotFromUdot;
+};
+
+ActuatorCoefficients actuatorCoefficients(double omega, double gamma, double dt);
+
+// time steps that differ only by the round-off of differencing simulation times share a discretisation
+inline bool sameTimeStep(double dt1, double dt2)
+{
+    return std::abs(dt1 - dt2) <= 1e-9 * dt2;
+}
+
+/* A second order actuator. The transition is worked out for the time step given at construction and, with
+   variable time steps, for the few most recently used other steps, so that exp and sin are only evaluated when
+   the step changes to a new length. */
 class Actuator
 {
 public:
     Actuator(double omega, double gamma, double dt);
     ActuatorState output(double input);
+    ActuatorState output(double input, double dt);
+    /* The outputs for a whole series of inputs at the time step given at construction, leaving the actuator as if
+       output had been called for each in turn. With a pool the series is split into blocks that are stepped from
+       rest in parallel, then corrected by the response to each block's true starting state, which follows from
+       the previous blocks' ends. The results agree with output to round-off, not bit for bit. */
+    std::vector<ActuatorState> outputSeries(std::span<const double> input, ThreadPool* pool = nullptr);
+    // the state carried from one step to the next, saved and restored with the simulation
+    void getState(ActuatorState& state, double& input) const;
+    void setState(const ActuatorState& state, double input);
+private:
+    ActuatorState output(double input, const ActuatorCoefficients& coefficients);
+    const ActuatorCoefficients& coefficients(double dt);
 private:
     double omega;
     double gamma;
-    double dt;
     ActuatorState prevState;
     double uprev;
-    double g;
-    double f;
+    std::array<ActuatorCoefficients, 4> cache; // the first is for the time step given at construction
+    size_t nextCacheEntry = 1;
+    size_t cacheCount = 1;
 };
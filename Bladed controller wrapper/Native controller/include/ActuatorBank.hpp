@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+#include "Actuator.hpp"
+
+/* Many actuators stepped together, e.g. every blade of a turbine. The state and the transition coefficients of
+   the actuators are held as contiguous arrays so that a step is one pass of straight-line arithmetic over the
+   arrays, which the compiler vectorises. Coefficients are kept for the few most recently used time steps, as
+   for Actuator, whose outputs these are identical to. */
+class ActuatorBank
+{
+public:
+    ActuatorBank();
+
+    // returns the index of the new actuator
+    size_t add(double omega, double gamma);
+    size_t size() const { return x.size(); };
+
+    // steps every actuator over dt, input holds one value per actuator
+    void output(const double* input, double dt);
+    ActuatorState state(size_t index) const { return { x[index], xdot[index], xdotdot[index] }; };
+
+    // the state carried from one step to the next, saved and restored with the simulation
+    void getState(size_t index, ActuatorState& state, double& input) const;
+    void setState(size_t index, const ActuatorState& state, double input);
+private:
+    size_t cacheEntry(double dt);
+private:
+    static constexpr size_t cacheSize = 4;
+    std::vector<double> omega;
+    std::vector<double> gamma;
+    // per cache entry, each coefficient of ActuatorCoefficients in turn for every actuator
+    std::array<double, cacheSize> cachedDt;
+    std::array<std::vector<double>, cacheSize> cachedCoefficients;
+    size_t nextCacheEntry = 0;
+    std::vector<double> x;
+    std::vector<double> xdot;
+    std::vector<double> xdotdot;
+    std::vector<double> uprev;
+};
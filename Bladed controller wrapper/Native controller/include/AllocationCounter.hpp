@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+/* Number of heap allocations made through the global operator new by the calling thread. The counting
+   operator new is only compiled into builds with CHECK_STEP_ALLOCATIONS defined, and is used to check that
+   stepping a controller never allocates. In other builds the count is always zero. */
+#ifdef CHECK_STEP_ALLOCATIONS
+size_t allocationCount();
+#else
+inline size_t allocationCount() { return 0; }
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "OrcFxAPI.h"
+#include "OrcFxAPI_wrapper.hpp"
+#include "Actuator.hpp"
+#include <limits>
+#include <memory>
+
+using namespace Orcina;
+
+/* The NREL 5MW reference turbine baseline controller, https://www.nrel.gov/docs/fy09osti/38060.pdf, with the
+   floating system modifications of https://www.nrel.gov/docs/fy10osti/47535.pdf when the FloatingSystem tag is
+   True. This is ControllerEngine from PythonController.py compiled, with the same tags, the same arithmetic, so
+   outputs agree to round-off, and the same binary stored state. */
+class BaselineController
+{
+public:
+    explicit BaselineController(TExtFnInfo& info);
+
+    void update(const TExtFnInfo& info);
+    void storeState(TExtFnInfo& info) const;
+
+    double getTorque() const { return torque; };
+    double getPitch() const { return pitch; };
+    double getPitchDot() const { return pitchDot; };
+    double getPitchDotDot() const { return pitchDotDot; };
+
+    int addref() { return refCount++; };
+    int decref() { return --refCount; };
+private:
+    void setTimeStep(OrcaFlexObject& general);
+    void restoreState(const void* data, int length);
+private:
+    int refCount = 0;
+    double dt;
+    bool useActuator;
+    bool floatingSystem;
+    double momentScaleFactor;
+    std::unique_ptr<Actuator> actuator;
+
+    double kp;
+    double ki;
+    double slope15;
+    double slope25;
+    double trGnSp;
+
+    double lastUpdateTime = -std::numeric_limits<double>::infinity();
+    double filteredSpeed = 0;
+    double pitchCom = 0;
+    double torqueCom = 0;
+    double errorIntegral = 0;
+    double pitch = 0;
+    double pitchDot = 0;
+    double pitchDotDot = 0;
+    double torque = 0;
+};
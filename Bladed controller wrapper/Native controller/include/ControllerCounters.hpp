@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "DisconHost.hpp"
+#include "PhaseTimer.hpp"
+
+/* Live counters that a controller publishes to shared memory, enabled by the ControllerCounters tag, so that a
+   monitor can see how every simulation on the machine is progressing. Each controller has its own segment,
+   named with the counters prefix, the process and a serial number. The values are written once per time step
+   under a sequence lock: the sequence is odd while they are written, so a reader copies them and retries if
+   the sequence was odd or changed meanwhile.
+
+   The layout only uses fixed size types, like the DISCON host's. */
+
+constexpr uint32_t controllerCountersVersion = 1;
+constexpr size_t controllerCountersNameLength = 256;
+constexpr size_t controllerCountersModelLength = 1024;
+
+#ifdef _WIN32
+constexpr char controllerCountersPrefix[] = "Local\\ControllerCounters-";
+#else
+constexpr char controllerCountersPrefix[] = "/ControllerCounters-";
+#endif
+
+// written under the sequence lock
+struct ControllerCounterValues
+{
+    uint64_t timeSteps;
+    uint64_t disconCalls;
+    uint64_t disconTicks;
+    uint64_t sensorTicks; // OrcFxAPI results fetches
+    double ticksPerSecond; // of the time stamp counter, 0 until measured
+    double stepsPerSecond; // over the last second or so
+    double simulationTime;
+    int64_t updateTime; // steady clock nanoseconds, comparable between processes on one machine
+    int32_t aviFail;
+    uint32_t unused;
+    char avcMsg[STRINGLENGTH];
+};
+
+struct ControllerCountersBlock
+{
+    uint32_t version;
+    uint32_t processID;
+    char turbineName[controllerCountersNameLength]; // UTF-8
+    char modelFileName[controllerCountersModelLength]; // UTF-8, truncated
+    std::atomic<uint32_t> sequence;
+    uint32_t unused;
+    ControllerCounterValues values;
+};
+
+inline size_t controllerCountersBlockSize()
+{
+    return sizeof(ControllerCountersBlock);
+}
+
+class ControllerCounters
+{
+public:
+    ControllerCounters(const std::wstring& turbineName, const std::wstring& modelFileName);
+    ControllerCounters(const ControllerCounters&) = delete;
+    ControllerCounters& operator=(const ControllerCounters&) = delete;
+
+    // DISCON calls can be timed on a farm group's threads, so the totals are atomic
+    void add(Phase phase, uint64_t ticks)
+    {
+        if (phase == Phase::discon)
+        {
+            disconCalls.fetch_add(1, std::memory_order_relaxed);
+            disconTicks.fetch_add(ticks, std::memory_order_relaxed);
+        }
+        else if (phase == Phase::sensors)
+            sensorTicks.fetch_add(ticks, std::memory_order_relaxed);
+    }
+
+    void publish(double simulationTime, int aviFail, const char* avcMsg);
+private:
+    std::unique_ptr<SharedMemoryBlock> memory;
+    ControllerCountersBlock* block;
+    uint64_t timeSteps = 0;
+    std::atomic<uint64_t> disconCalls = 0;
+    std::atomic<uint64_t> disconTicks = 0;
+    std::atomic<uint64_t> sensorTicks = 0;
+    std::chrono::steady_clock::time_point windowStart;
+    uint64_t windowStartTicks;
+    uint64_t windowStartSteps = 0;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include "OrcFxAPI.h"
+#include "Utils.hpp"
+
+/* Controller quantities offered as OrcaFlex results of the turbine, so that they can be extracted like any
+   other time history. The torque external function offers the turbine's results and the pitch external
+   function the per blade ones. At each log sample a function logs its own results, packed as a header
+   followed by the values in table order. Results are derived from the logged values alone, since that
+   is also done for simulations loaded from file, when there is no controller. */
+
+enum class ControllerResult
+{
+    yawError,
+    nacelleYaw,
+    torqueDemand,
+    noddingAcceleration,
+    noddingAngularAcceleration,
+    pitchDemand1,
+    pitchDemand2,
+    pitchDemand3,
+    pitchRate1,
+    pitchRate2,
+    pitchRate3,
+    count
+};
+
+constexpr size_t controllerResultCount = static_cast<size_t>(ControllerResult::count);
+
+using ControllerResultValues = std::array<double, controllerResultCount>;
+
+struct ControllerResultInfo
+{
+    ControllerResult id;
+    ControlledVar var; // the external function offering the result
+    const wchar_t* name;
+    const wchar_t* units; // LL, FF and TT are the model's length, force and time units
+};
+
+// with common pitch control the demand is blade 1's and other blades have no value
+constexpr ControllerResultInfo controllerResults[] = {
+    { ControllerResult::yawError, ControlledVar::torque, L"Controller yaw error", L"deg" },
+    { ControllerResult::nacelleYaw, ControlledVar::torque, L"Controller nacelle yaw", L"deg" },
+    { ControllerResult::torqueDemand, ControlledVar::torque, L"DISCON generator torque demand", L"FF.LL" },
+    { ControllerResult::noddingAcceleration, ControlledVar::torque, L"Controller nodding acceleration", L"LL/TT^2" },
+    { ControllerResult::noddingAngularAcceleration, ControlledVar::torque, L"Controller nodding angular acceleration", L"rad/TT^2" },
+    { ControllerResult::pitchDemand1, ControlledVar::pitch, L"DISCON pitch demand blade 1", L"rad" },
+    { ControllerResult::pitchDemand2, ControlledVar::pitch, L"DISCON pitch demand blade 2", L"rad" },
+    { ControllerResult::pitchDemand3, ControlledVar::pitch, L"DISCON pitch demand blade 3", L"rad" },
+    { ControllerResult::pitchRate1, ControlledVar::pitch, L"Pitch actuator rate blade 1", L"rad/TT" },
+    { ControllerResult::pitchRate2, ControlledVar::pitch, L"Pitch actuator rate blade 2", L"rad/TT" },
+    { ControllerResult::pitchRate3, ControlledVar::pitch, L"Pitch actuator rate blade 3", L"rad/TT" },
+};
+
+// results are identified to OrcaFlex by their position in the table
+constexpr bool controllerResultsInOrder()
+{
+    if (std::size(controllerResults) != controllerResultCount)
+        return false;
+    for (size_t i = 0; i < controllerResultCount; i++)
+        if (static_cast<size_t>(controllerResults[i].id) != i)
+            return false;
+    return true;
+}
+
+static_assert(controllerResultsInOrder(), "Controller results must be listed once each, in ControllerResult order.");
+
+constexpr uint32_t loggedResultsVersion = 1;
+
+struct LoggedResultsHeader
+{
+    uint32_t version;
+    uint32_t var; // the ControlledVar of the external function that logged them
+    uint32_t count; // doubles following
+    uint32_t unused;
+};
+
+// at eaRegisterResults, the results offered by the external function
+void registerControllerResults(TExtFnInfo& info);
+
+// at eaLogResultCreate, released at eaLogResultDestroy
+void logControllerResults(TExtFnInfo& info, const ControllerResultValues& values);
+void destroyLoggedResults(TExtFnInfo& info);
+
+// at eaDeriveResult, the value of info.ResultID
+void deriveControllerResult(TExtFnInfo& info);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "SwapRecords.hpp"
+
+/* Shared memory layout and signalling used to run DISCON in a separate host process. The wrapper creates a
+   block with one slot per turbine and launches the host, which serves each slot on its own thread. A command
+   is posted by writing the slot's data and bumping request; the host completes it and sets response equal to
+   request. Each side spins briefly before sleeping on the other's sequence word, so a round trip costs a few
+   microseconds when both sides are busy and no CPU when idle.
+
+   The layout only uses fixed size types so that a 64-bit wrapper can drive a 32-bit host. */
+
+constexpr uint32_t disconHostVersion = 1;
+constexpr size_t disconHostPathLength = 2048;
+
+enum class DisconHostCommand : uint32_t { none, attach, call, detach };
+
+struct DisconHostSlot
+{
+    std::atomic<uint32_t> request;
+    std::atomic<uint32_t> response;
+    std::atomic<uint32_t> clientWaiting;
+    std::atomic<uint32_t> hostWaiting;
+    uint32_t command;
+    int32_t aviFail;
+    float avrSwap[swapRecordCount];
+    char dllFileName[disconHostPathLength]; // UTF-8
+    char accInfile[STRINGLENGTH];
+    char avcOutfile[STRINGLENGTH];
+    char avcMsg[STRINGLENGTH];
+};
+
+struct DisconHostBlock
+{
+    uint32_t version;
+    uint32_t slotCount;
+    std::atomic<uint32_t> shutdown;
+    uint32_t unused;
+    DisconHostSlot slots[1]; // slotCount slots
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory signalling requires lock free atomics.");
+
+inline size_t disconHostBlockSize(uint32_t slotCount)
+{
+    return sizeof(DisconHostBlock) + (slotCount - 1) * sizeof(DisconHostSlot);
+}
+
+// name of the operating system object used to wake a sleeping waiter, only used on Windows
+std::string disconHostEventName(const std::string& blockName, uint32_t slotIndex, const char* direction);
+
+class SharedMemoryBlock
+{
+public:
+    SharedMemoryBlock(const std::string& name, size_t size); // create
+    SharedMemoryBlock(const std::string& name); // open existing
+    ~SharedMemoryBlock();
+    SharedMemoryBlock(const SharedMemoryBlock&) = delete;
+    SharedMemoryBlock& operator=(const SharedMemoryBlock&) = delete;
+    void* data() const { return address; };
+private:
+    std::string name;
+    void* address = nullptr;
+    size_t size = 0;
+    void* handle = nullptr;
+    bool owner = false;
+};
+
+/* One direction of the handshake: a sequence word, a flag set while the other side sleeps on it and, on
+   Windows, a named event to wake it with. */
+class DisconHostSignal
+{
+public:
+    DisconHostSignal(std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiting, const std::string& eventName);
+    ~DisconHostSignal();
+    DisconHostSignal(const DisconHostSignal&) = delete;
+    DisconHostSignal& operator=(const DisconHostSignal&) = delete;
+    void post(uint32_t value);
+    bool waitChange(uint32_t last, int timeoutMilliseconds); // true once the word differs from last
+private:
+    void sleep(uint32_t current, int timeoutMilliseconds);
+    void wake();
+private:
+    std::atomic<uint32_t>& word;
+    std::atomic<uint32_t>& waiting;
+    void* event = nullptr;
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+/* A copy of a controller library reserved for one instance in this process, for DLLs that cannot be shared
+   between turbines. Copies live in a wrapper folder of the temp directory and are named by a hash of the
+   library's contents and an instance number, so they are made once and then reused by later turbines and
+   later simulations rather than copied afresh every time. Only the reservation is released on destruction,
+   the file is kept. */
+class LibraryCopy
+{
+public:
+    explicit LibraryCopy(const std::filesystem::path& sourceFileName);
+    ~LibraryCopy();
+    LibraryCopy(const LibraryCopy&) = delete;
+    LibraryCopy& operator=(const LibraryCopy&) = delete;
+    const std::filesystem::path& fileName() const { return copyFileName; };
+private:
+    std::string key;
+    uint32_t instance = 0;
+    std::filesystem::path copyFileName;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "Platform.hpp"
+#include "StateSnapshot.hpp"
+
+/* The internal memory of a controller library loaded for a single turbine, i.e. its writable static data (the
+   .data and .bss of Fortran modules and C statics), saved with the simulation so that a resumed DISCON
+   carries on warm rather than starting again from iStatus 0.
+
+   The pristine data is captured as soon as the library is loaded. When memory is restored into a newly loaded
+   instance, each pointer-sized word that had not changed since load keeps the new instance's value, so
+   relocated addresses stay valid, words pointing into the old image are rebased onto the new one and every
+   other word is written back as saved. Memory the controller allocates itself cannot be found this way, so a
+   controller that keeps state on the heap must export
+
+       size_t DISCON_SaveMemory(void* buffer, size_t size);    // writes up to size bytes, returns the size needed
+       int DISCON_RestoreMemory(const void* buffer, size_t size); // 0 on success
+
+   DISCON_RestoreMemory is called once the static data has been restored, so it must allocate afresh rather than
+   free any heap pointers it finds there. */
+class LibraryMemory
+{
+public:
+    explicit LibraryMemory(LibraryHandle lib);
+    LibraryMemory(const LibraryMemory&) = delete;
+    LibraryMemory& operator=(const LibraryMemory&) = delete;
+
+    void save(StateWriter& writer) const;
+    void restore(StateReader& reader);
+    static void skip(StateReader& reader);
+private:
+    MemoryRange image;
+    std::vector<MemoryRange> data;
+    std::vector<char> pristine;
+    void* saveMemory = nullptr;
+    void* restoreMemory = nullptr;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+template<size_t M>
+using Matrix = std::array<double, M * M>; // row major
+
+template<size_t M>
+inline Matrix<M> multiply(const Matrix<M>& a, const Matrix<M>& b)
+{
+    Matrix<M> result{};
+    for (size_t i = 0; i < M; i++)
+        for (size_t k = 0; k < M; k++)
+            for (size_t j = 0; j < M; j++)
+                result[i * M + j] += a[i * M + k] * b[k * M + j];
+    return result;
+}
+
+/* The exponential of a small square matrix by scaling and squaring: a Taylor series for the matrix divided by 2^k,
+   so that its norm is at most 1/2, is squared k times. For a system matrix times a time step this is the
+   transition over a sub-step of dt / 2^k, powered up to the whole step. */
+template<size_t M>
+inline Matrix<M> exponential(Matrix<M> a)
+{
+    double norm = 0;
+    for (size_t i = 0; i < M; i++)
+    {
+        double rowSum = 0;
+        for (size_t j = 0; j < M; j++)
+            rowSum += std::abs(a[i * M + j]);
+        norm = std::max(norm, rowSum);
+    }
+    int squarings = 0;
+    while (norm > 0.5)
+    {
+        norm /= 2;
+        squarings++;
+    }
+    double scale = std::ldexp(1.0, -squarings);
+    for (double& value : a)
+        value *= scale;
+
+    Matrix<M> result{};
+    Matrix<M> term{};
+    for (size_t i = 0; i < M; i++)
+        result[i * M + i] = term[i * M + i] = 1;
+    for (int k = 1; k <= 20; k++)
+    {
+        term = multiply<M>(term, a);
+        for (double& value : term)
+            value /= k;
+        for (size_t i = 0; i < M * M; i++)
+            result[i] += term[i];
+    }
+
+    for (int i = 0; i < squarings; i++)
+        result = multiply<M>(result, result);
+    return result;
+}
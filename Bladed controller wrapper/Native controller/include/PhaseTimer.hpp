@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Timing of the phases of a controller step, enabled by the ControllerTiming tag. Phases are timed with the
+   processor's time stamp counter, and each duration is counted in a histogram with four buckets per power of
+   two, so quantiles are resolved to within a fifth. The same timers mark the phases on a TraceSession's timeline
+   when tracing, and add to a controller's live ControllerCounters. With none of these on, a timer costs an
+   untaken branch. */
+
+inline uint64_t timestamp()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+class TimingHistogram
+{
+public:
+    void add(uint64_t ticks)
+    {
+        buckets[bucket(ticks)]++;
+        count++;
+        total += ticks;
+        max = std::max(max, ticks);
+    }
+
+    uint64_t calls() const { return count; };
+    uint64_t totalTicks() const { return total; };
+    uint64_t maxTicks() const { return max; };
+    // the least duration at or above the given fraction of those counted, to the resolution of the buckets
+    uint64_t quantile(double fraction) const;
+private:
+    static size_t bucket(uint64_t ticks);
+    static uint64_t bucketUpperBound(size_t index);
+private:
+    std::array<uint64_t, 252> buckets = {};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+};
+
+enum class Phase { calculate, sensors, inputs, discon, outputs, actuator, yaw };
+constexpr size_t phaseCount = 7;
+
+const wchar_t* phaseName(Phase phase);
+
+class TraceSession;
+class ControllerCounters;
+
+class PhaseTimers
+{
+public:
+    void enable();
+    // marks phases on the session's timeline as those of the given turbine
+    void trace(TraceSession* session, uint32_t turbine);
+    // adds the durations of the phases that the counters total
+    void count(ControllerCounters* counters);
+    bool enabled() const { return on || traceSession || counters; };
+
+    // the simulation time given with trace events
+    void setSimulationTime(double time) { simulationTime = time; };
+
+    void begin(Phase phase, uint64_t ticks)
+    {
+        if (traceSession)
+            traceEvent(phase, ticks, true);
+    }
+
+    void end(Phase phase, uint64_t startTicks, uint64_t endTicks)
+    {
+        if (on)
+            histograms[static_cast<size_t>(phase)].add(endTicks - startTicks);
+        if (traceSession)
+            traceEvent(phase, endTicks, false);
+        if (counters)
+            countEvent(phase, endTicks - startTicks);
+    }
+
+    // OrcaFlex calls calculate more than once in a time step, for each controlled variable and each iteration
+    void countTimeStep()
+    {
+        if (on)
+            timeSteps++;
+    }
+
+    // a table of the phases, with times in microseconds converted at the counter's rate since timing was enabled
+    std::wstring summary(const std::wstring& title) const;
+private:
+    void traceEvent(Phase phase, uint64_t ticks, bool begin);
+    void countEvent(Phase phase, uint64_t ticks);
+private:
+    bool on = false;
+    TraceSession* traceSession = nullptr;
+    uint32_t traceTurbine = 0;
+    ControllerCounters* counters = nullptr;
+    double simulationTime = 0;
+    std::array<TimingHistogram, phaseCount> histograms;
+    uint64_t timeSteps = 0;
+    uint64_t startTicks = 0;
+    std::chrono::steady_clock::time_point startTime;
+};
+
+// times the enclosing scope as a phase
+class PhaseTimer
+{
+public:
+    PhaseTimer(PhaseTimers& timers, Phase phase)
+        : timers(timers.enabled() ? &timers : nullptr), phase(phase), start(this->timers ? timestamp() : 0)
+    {
+        if (this->timers)
+            this->timers->begin(phase, start);
+    }
+
+    ~PhaseTimer()
+    {
+        if (timers)
+            timers->end(phase, start, timestamp());
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+private:
+    PhaseTimers* timers;
+    Phase phase;
+    uint64_t start;
+};
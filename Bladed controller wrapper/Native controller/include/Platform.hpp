@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Operating system services used by the wrapper, implemented for Win32 and for POSIX (Linux)
+
+typedef void* LibraryHandle;
+
+#ifdef _WIN32
+constexpr wchar_t libraryExtension[] = L".dll";
+#else
+constexpr wchar_t libraryExtension[] = L".so";
+#endif
+
+// the controller library to load for a ControllerDLL tag, on Linux discon.dll is looked for as libdiscon.so
+std::filesystem::path nativeLibraryFileName(const std::filesystem::path& fileName);
+
+LibraryHandle loadLibrary(const std::filesystem::path& fileName); // nullptr on failure, see lastLibraryError
+// loads a further instance of a library with its own static data, nullptr if the platform cannot
+LibraryHandle loadIsolatedLibrary(const std::filesystem::path& fileName);
+void* librarySymbol(LibraryHandle lib, const char* name);
+void freeLibrary(LibraryHandle lib);
+std::wstring lastLibraryError();
+
+struct MemoryRange
+{
+    char* address;
+    size_t size;
+};
+
+// the extent of a loaded library's image and its writable static data (.data and .bss), false if not found
+bool libraryWritableData(LibraryHandle lib, MemoryRange& image, std::vector<MemoryRange>& data);
+
+/* A file mapped into memory, so that what is stored in it can be read by other processes while it is written.
+   Created files are sized and zero filled, existing files are opened read only. */
+class MappedFile
+{
+public:
+    MappedFile(const std::filesystem::path& fileName, size_t size); // create, replacing any existing file
+    explicit MappedFile(const std::filesystem::path& fileName); // open existing, read only
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    void* data() const { return address; };
+    size_t size() const { return length; };
+private:
+    void* address = nullptr;
+    size_t length = 0;
+    void* handle = nullptr;
+};
+
+std::wstring createUniqueName();
+
+std::string utf16ToUtf8(const std::wstring& value);
+std::wstring utf8ToUtf16(const std::string value);
+
+// converts to the 8 bit encoding DISCON expects for file names, false if not representable or too long
+bool convertTo8bitText(const std::wstring& input, char* output, size_t outputLen);
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include "DisconHost.hpp"
+
+class DisconHostProcess;
+
+/* A controller DLL loaded into a DisconHost process rather than into OrcaFlex, so that a crash in the DLL is
+   reported as an error rather than taking down the simulation, and so that a DLL of a different bitness can
+   be used. Host processes are shared by up to turbinesPerHost controllers that use the same host executable.
+   Calls have the same signature as DISCON itself. */
+class RemoteDiscon
+{
+public:
+    RemoteDiscon(const std::filesystem::path& hostFileName, const std::filesystem::path& dllFileName, uint32_t turbinesPerHost);
+    ~RemoteDiscon();
+    RemoteDiscon(const RemoteDiscon&) = delete;
+    RemoteDiscon& operator=(const RemoteDiscon&) = delete;
+    void call(float* avrSwap, int* aviFail, const char* accInfile, const char* avcOutfile, char* avcMsg);
+private:
+    void execute(DisconHostCommand command);
+    void release();
+private:
+    std::shared_ptr<DisconHostProcess> host;
+    uint32_t slotIndex = 0;
+    DisconHostSlot* slot = nullptr;
+    std::unique_ptr<DisconHostSignal> request;
+    std::unique_ptr<DisconHostSignal> response;
+    uint32_t sequence = 0;
+    bool fileNamesSent = false;
+};
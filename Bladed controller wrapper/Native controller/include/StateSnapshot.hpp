@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/* Binary state for OrcaFlex StoreState. A snapshot starts with a four character tag identifying its owner and a
+   version number, followed by trivially copyable values in the order they were written. Snapshots are only
+   read back by the same build on the same platform, so values are stored in native byte order. */
+
+class StateWriter
+{
+public:
+    StateWriter(const char (&tag)[5], uint32_t version)
+    {
+        writeBytes(tag, 4);
+        write(version);
+    }
+
+    template<typename T>
+    void write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "State values must be trivially copyable.");
+        writeBytes(&value, sizeof(T));
+    }
+
+    void writeBytes(const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    const std::vector<char>& data() const { return buffer; };
+private:
+    std::vector<char> buffer;
+};
+
+class StateReader
+{
+public:
+    // throws unless the data starts with tag, returns the version through version
+    StateReader(const void* data, size_t size, const char (&tag)[5], uint32_t& version)
+        : data(static_cast<const char*>(data)), size(size)
+    {
+        if (size < 4 || memcmp(data, tag, 4) != 0)
+            throw std::runtime_error("Stored state was not written by this controller.");
+        position = 4;
+        read(version);
+    }
+
+    template<typename T>
+    void read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "State values must be trivially copyable.");
+        readBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    T read()
+    {
+        T value;
+        read(value);
+        return value;
+    }
+
+    // the next count bytes in place, without copying them
+    const char* readBytes(size_t count)
+    {
+        if (size - position < count)
+            throw std::runtime_error("Stored state is truncated.");
+        const char* result = data + position;
+        position += count;
+        return result;
+    }
+
+    void readBytes(void* value, size_t count)
+    {
+        memcpy(value, readBytes(count), count);
+    }
+
+    bool atEnd() const { return position == size; };
+private:
+    const char* data;
+    size_t size;
+    size_t position = 0;
+};
+
+// hands a snapshot to OrcaFlex at eaStoreStateCreate, released at eaStoreStateDestroy
+template<typename Info>
+void storeState(Info& info, const StateWriter& writer)
+{
+    const std::vector<char>& data = writer.data();
+    char* buffer = new char[data.size()];
+    memcpy(buffer, data.data(), data.size());
+    info.lpStateData = buffer;
+    info.LengthOfStateData = static_cast<int>(data.size());
+}
+
+template<typename Info>
+void destroyState(Info& info)
+{
+    delete[] static_cast<char*>(info.lpStateData);
+    info.lpStateData = nullptr;
+    info.LengthOfStateData = 0;
+}
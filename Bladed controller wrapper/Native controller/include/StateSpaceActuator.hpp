@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Actuator.hpp"
+
+/* A linear actuator model of any order up to six, dx/dt = A x + B u and y = C x + D u, for drives that the second
+   order Actuator does not describe, e.g. with bearing friction, servo-valve lag or a notch filter. The input u is
+   the demand and the outputs y are the actuator position and optionally its first and second derivatives, which
+   are otherwise zero. */
+struct StateSpaceModel
+{
+    size_t order = 0;
+    size_t outputCount = 0;
+    std::vector<double> A; // order by order, row major
+    std::vector<double> B; // order
+    std::vector<double> C; // outputCount by order, row major
+    std::vector<double> D; // outputCount
+};
+
+/* Reads a model from JSON of the form {"A": [[...], ...], "B": [...], "C": [[...], ...], "D": [...]}, D being
+   optional, given either as the text itself or as the name of a file relative to directory. */
+StateSpaceModel loadStateSpaceModel(const std::wstring& value, const std::filesystem::path& directory);
+
+/* The model is discretised exactly with a matrix exponential for an input varying linearly over each time step,
+   as Actuator is, once for the time step given at creation and for the few most recently used other steps. A
+   step is then a matrix-vector product of the model's order, which is fixed at compile time. */
+class StateSpaceActuator
+{
+public:
+    static constexpr size_t maxOrder = 6;
+
+    virtual ~StateSpaceActuator() = default;
+    virtual size_t order() const = 0;
+    virtual ActuatorState output(double input, double dt) = 0;
+    // the state carried from one step to the next, order() values and the previous input
+    virtual void getState(double* state, double& input) const = 0;
+    virtual void setState(const double* state, double input) = 0;
+};
+
+std::unique_ptr<StateSpaceActuator> createStateSpaceActuator(const StateSpaceModel& model, double dt);
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "Platform.hpp"
+#include "SwapRecords.hpp"
+
+/* A ring of avrSwap values in a memory mapped file, enabled per turbine by the ControllerLogFile tag, as a
+   binary alternative to a controller's own text debug output. Each row holds the time and the selected records
+   as DISCON returned them, so that both its inputs and its outputs are seen. A row is written for every
+   decimation'th DISCON call, into slot rowsWritten modulo the capacity, and rowsWritten is then published, so
+   the file can be read while the simulation runs (see SwapLogView). A reader copies rows and then reads
+   rowsWritten again, discarding any row the writer may have overwritten meanwhile.
+
+   The layout only uses fixed size types, and rows start headerSize bytes into the file. */
+
+constexpr char swapLogTag[4] = { 'C', 'S', 'W', 'L' };
+constexpr uint32_t swapLogVersion = 1;
+constexpr size_t swapLogNameLength = 256;
+
+struct SwapLogHeader
+{
+    char tag[4];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t rowSize; // a double time then a float per column, padded to 8 bytes
+    uint32_t columnCount;
+    uint32_t decimation;
+    uint64_t rowCapacity;
+    std::atomic<uint64_t> rowsWritten;
+    uint32_t records[swapRecordCount]; // the 1-based avrSwap index of each column
+    char turbineName[swapLogNameLength]; // UTF-8
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The log's row count must be lock free to be shared.");
+
+inline uint32_t swapLogHeaderSize()
+{
+    return (sizeof(SwapLogHeader) + 63) / 64 * 64;
+}
+
+inline uint32_t swapLogRowSize(size_t columnCount)
+{
+    return static_cast<uint32_t>((sizeof(double) + columnCount * sizeof(float) + 7) / 8 * 8);
+}
+
+class SwapLogWriter
+{
+public:
+    SwapLogWriter(const std::filesystem::path& fileName, const std::vector<size_t>& records, uint64_t rowCapacity,
+        uint32_t decimation, const std::wstring& turbineName);
+    SwapLogWriter(const SwapLogWriter&) = delete;
+    SwapLogWriter& operator=(const SwapLogWriter&) = delete;
+
+    void write(double time, const float* avrSwap)
+    {
+        if (calls++ % decimation != 0)
+            return;
+        uint64_t row = header->rowsWritten.load(std::memory_order_relaxed);
+        char* address = rows + (row % rowCapacity) * rowSize;
+        memcpy(address, &time, sizeof(time));
+        float* values = reinterpret_cast<float*>(address + sizeof(time));
+        for (size_t i = 0; i < columnCount; i++)
+            values[i] = avrSwap[records[i]];
+        header->rowsWritten.store(row + 1, std::memory_order_release);
+    }
+private:
+    MappedFile file;
+    SwapLogHeader* header;
+    char* rows;
+    uint32_t rowSize;
+    uint64_t rowCapacity;
+    uint32_t decimation;
+    size_t columnCount;
+    std::array<uint32_t, swapRecordCount> records; // 0-based
+    uint64_t calls = 0;
+};
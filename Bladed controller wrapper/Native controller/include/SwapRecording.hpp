@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include "SwapRecords.hpp"
+
+/* Recordings of the avrSwap arrays passed to DISCON, enabled per turbine by the ControllerRecordFile tag, so
+   that a controller can be run again offline on the same inputs with DisconReplay. A recording is a header
+   followed by one frame per DISCON call, from the first (iStatus 0) to the last (iStatus -1) if the simulation
+   finished. A frame holds the time, the time step and avrSwap as the wrapper passed it, so it includes the
+   records DISCON itself wrote on earlier calls. DisconReplay writes its outputs in the same format, with avrSwap
+   as DISCON returned it.
+
+   Frames are fixed size and, like state snapshots, in native byte order. */
+
+constexpr char swapRecordingTag[4] = { 'C', 'S', 'W', 'P' };
+constexpr uint32_t swapRecordingVersion = 1;
+
+struct SwapRecordingHeader
+{
+    char tag[4];
+    uint32_t version;
+    uint32_t recordCount; // avrSwap records in each frame
+    uint32_t frameSize;
+    char accInfile[STRINGLENGTH];
+    char avcOutfile[STRINGLENGTH];
+};
+
+struct SwapFrame
+{
+    double time; // since the start of the simulation, as record 2
+    double dt; // the simulation time step, record 3 is the controller's sample period if it has one
+    float avrSwap[swapRecordCount];
+};
+
+// collects frames in memory and writes them in blocks, so that recording a DISCON call is just a copy; the
+// owner flushes the last block, as the writer cannot report an error from its destructor
+class SwapRecordingWriter
+{
+public:
+    SwapRecordingWriter(const std::filesystem::path& fileName, const char* accInfile, const char* avcOutfile);
+    SwapRecordingWriter(const SwapRecordingWriter&) = delete;
+    SwapRecordingWriter& operator=(const SwapRecordingWriter&) = delete;
+
+    void write(double time, double dt, const float* avrSwap);
+    void flush();
+private:
+    std::filesystem::path fileName;
+    std::ofstream file;
+    std::vector<SwapFrame> frames;
+    size_t frameCount = 0;
+};
+
+// reads frames in blocks; a frame cut short, by a simulation that did not finish, is ignored
+class SwapRecordingReader
+{
+public:
+    explicit SwapRecordingReader(const std::filesystem::path& fileName);
+
+    const SwapRecordingHeader& header() const { return recordingHeader; }
+
+    // the next frame, valid until the following call, or nullptr at the end of the recording
+    const SwapFrame* next();
+private:
+    std::filesystem::path fileName;
+    std::ifstream file;
+    SwapRecordingHeader recordingHeader;
+    std::vector<SwapFrame> frames;
+    size_t frameCount = 0;
+    size_t position = 0;
+};
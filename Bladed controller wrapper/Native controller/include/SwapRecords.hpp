@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+/* Schema for the Bladed style avrSwap array exchanged with DISCON. Each record lists its 1-based index, the
+   wrapper value it is packed from (or unpacked to), the factor converting that value from OrcaFlex to DISCON
+   units, the model units scale it is divided by and the pitch control mode and blade it applies to. The pack
+   and unpack kernels are generated from these tables at compile time, one per pitch control mode and blade
+   count, so that stepping the controller is a straight-line sequence of stores with no branches. */
+
+constexpr size_t swapRecordCount = 84;
+
+// length of the DISCON character arrays: accInfile, avcOutname and avcMsg
+#define STRINGLENGTH 1024
+
+enum class PitchControl { common, individual, both };
+
+enum class SwapScale { none, moment, velocity, acceleration, count };
+
+enum class SwapInput
+{
+    constant, // the record factor is the value
+    status,
+    time,
+    timeStep,
+    commonPitch, // rad
+    bladePitch1, // deg
+    bladePitch2,
+    bladePitch3,
+    generatorPower,
+    generatorSpeed,
+    rotorSpeed,
+    generatorTorque,
+    yawError, // deg
+    hubWindSpeed,
+    rootMomentEy1,
+    rootMomentEy2,
+    rootMomentEy3,
+    nacelleYaw, // deg
+    messageLength,
+    infileLength,
+    outfileLength,
+    noddingAcceleration,
+    rotorAzimuth,
+    bladeCount,
+    rootMomentEx1,
+    rootMomentEx2,
+    rootMomentEx3,
+    hubMomentLy,
+    hubMomentLx,
+    noddingAngularAcceleration,
+    count
+};
+
+enum class SwapOutput
+{
+    pitchCommand1,
+    pitchCommand2,
+    pitchCommand3,
+    generatorTorque,
+    yawRate,
+    shaftBrakeStatus,
+    count
+};
+
+template<typename Enum>
+struct SwapValues
+{
+    std::array<double, static_cast<size_t>(Enum::count)> values{};
+    double& operator[](Enum value) { return values[static_cast<size_t>(value)]; }
+    double operator[](Enum value) const { return values[static_cast<size_t>(value)]; }
+};
+
+using SwapInputValues = SwapValues<SwapInput>;
+using SwapOutputValues = SwapValues<SwapOutput>;
+using SwapScales = SwapValues<SwapScale>;
+
+// the value for blade bladeIndex (0-based) of a per-blade value, where first is the value for blade 1
+template<typename Enum>
+constexpr Enum bladeValue(Enum first, int bladeIndex)
+{
+    return static_cast<Enum>(static_cast<int>(first) + bladeIndex);
+}
+
+template<typename Enum>
+struct SwapRecord
+{
+    size_t index; // 1-based FORTRAN index
+    Enum value;
+    double factor;
+    SwapScale scale;
+    PitchControl mode;
+    int blade; // 0-based blade the record belongs to, -1 if not blade specific
+};
+
+constexpr double degreesToRadians = std::numbers::pi / 180;
+
+// DLL assumed to work in Nm, OrcaFlex moments are in kN.m scaled by the model units
+constexpr SwapRecord<SwapInput> swapInputRecords[] = {
+    { 1, SwapInput::status, 1, SwapScale::none, PitchControl::both, -1 },
+    { 2, SwapInput::time, 1, SwapScale::none, PitchControl::both, -1 },
+    { 3, SwapInput::timeStep, 1, SwapScale::none, PitchControl::both, -1 },
+    { 4, SwapInput::commonPitch, 1, SwapScale::none, PitchControl::common, -1 },
+    { 4, SwapInput::bladePitch1, degreesToRadians, SwapScale::none, PitchControl::individual, 0 },
+    { 15, SwapInput::generatorPower, -1000, SwapScale::moment, PitchControl::both, -1 }, // not factored by efficiency
+    { 20, SwapInput::generatorSpeed, 1, SwapScale::none, PitchControl::both, -1 },
+    { 21, SwapInput::rotorSpeed, 1, SwapScale::none, PitchControl::both, -1 },
+    { 23, SwapInput::generatorTorque, -1000, SwapScale::moment, PitchControl::both, -1 },
+    { 24, SwapInput::yawError, degreesToRadians, SwapScale::none, PitchControl::both, -1 },
+    { 27, SwapInput::hubWindSpeed, 1, SwapScale::velocity, PitchControl::both, -1 },
+    { 28, SwapInput::constant, 0, SwapScale::none, PitchControl::common, -1 },
+    { 28, SwapInput::constant, 1, SwapScale::none, PitchControl::individual, -1 },
+    { 30, SwapInput::rootMomentEy1, -1000, SwapScale::moment, PitchControl::both, 0 },
+    { 31, SwapInput::rootMomentEy2, -1000, SwapScale::moment, PitchControl::both, 1 },
+    { 32, SwapInput::rootMomentEy3, -1000, SwapScale::moment, PitchControl::both, 2 },
+    { 33, SwapInput::commonPitch, 1, SwapScale::none, PitchControl::common, -1 },
+    { 33, SwapInput::bladePitch2, degreesToRadians, SwapScale::none, PitchControl::individual, 1 },
+    { 34, SwapInput::commonPitch, 1, SwapScale::none, PitchControl::common, -1 },
+    { 34, SwapInput::bladePitch3, degreesToRadians, SwapScale::none, PitchControl::individual, 2 },
+    { 37, SwapInput::nacelleYaw, degreesToRadians, SwapScale::none, PitchControl::both, -1 },
+    { 49, SwapInput::messageLength, 1, SwapScale::none, PitchControl::both, -1 },
+    { 50, SwapInput::infileLength, 1, SwapScale::none, PitchControl::both, -1 },
+    { 51, SwapInput::outfileLength, 1, SwapScale::none, PitchControl::both, -1 },
+    { 53, SwapInput::noddingAcceleration, 1, SwapScale::acceleration, PitchControl::both, -1 },
+    { 60, SwapInput::rotorAzimuth, 1, SwapScale::none, PitchControl::both, -1 },
+    { 61, SwapInput::bladeCount, 1, SwapScale::none, PitchControl::both, -1 },
+    { 69, SwapInput::rootMomentEx1, -1000, SwapScale::moment, PitchControl::both, 0 },
+    { 70, SwapInput::rootMomentEx2, -1000, SwapScale::moment, PitchControl::both, 1 },
+    { 71, SwapInput::rootMomentEx3, -1000, SwapScale::moment, PitchControl::both, 2 },
+    // assumes: ofx turbine Ly = -ve DLL Ly; ofx turbine Lx = DLL Lz; and DLL load is rotor side to gen
+    // side (whereas ofx connection load is parent to child)
+    { 75, SwapInput::hubMomentLy, 1000, SwapScale::moment, PitchControl::both, -1 },
+    { 76, SwapInput::hubMomentLx, -1000, SwapScale::moment, PitchControl::both, -1 },
+    { 83, SwapInput::noddingAngularAcceleration, -1, SwapScale::none, PitchControl::both, -1 }, // -ve convert to FAST coordinate system
+};
+
+// DLL assumed to return torque in Nm, which is converted to OrcaFlex SI units (kN.m) and then to model units
+constexpr SwapRecord<SwapOutput> swapOutputRecords[] = {
+    { 42, SwapOutput::pitchCommand1, 1, SwapScale::none, PitchControl::individual, 0 },
+    { 43, SwapOutput::pitchCommand2, 1, SwapScale::none, PitchControl::individual, 1 },
+    { 44, SwapOutput::pitchCommand3, 1, SwapScale::none, PitchControl::individual, 2 },
+    { 45, SwapOutput::pitchCommand1, 1, SwapScale::none, PitchControl::common, 0 },
+    { 47, SwapOutput::generatorTorque, -1000, SwapScale::moment, PitchControl::both, -1 },
+    { 48, SwapOutput::yawRate, 1, SwapScale::none, PitchControl::both, -1 },
+    { 36, SwapOutput::shaftBrakeStatus, 1, SwapScale::none, PitchControl::both, -1 },
+};
+
+template<typename Enum>
+constexpr bool appliesTo(const SwapRecord<Enum>& record, PitchControl mode, int bladeCount)
+{
+    return (record.mode == PitchControl::both || record.mode == mode) && record.blade < bladeCount;
+}
+
+// every record must lie within avrSwap and belong to one of at most three blades, and no two records may
+// be written for the same mode
+template<typename Enum, size_t N>
+constexpr bool validSwapRecords(const SwapRecord<Enum> (&records)[N])
+{
+    for (size_t i = 0; i < N; i++)
+    {
+        if (records[i].index < 1 || records[i].index > swapRecordCount || records[i].blade > 2)
+            return false;
+        for (size_t j = i + 1; j < N; j++)
+            if (records[i].index == records[j].index &&
+                (records[i].mode == PitchControl::both || records[j].mode == PitchControl::both || records[i].mode == records[j].mode))
+                return false;
+    }
+    return true;
+}
+
+static_assert(validSwapRecords(swapInputRecords), "Invalid avrSwap input record table.");
+static_assert(validSwapRecords(swapOutputRecords), "Invalid avrSwap output record table.");
+
+// the 1-based indices of the records exchanged with DISCON for a pitch control mode and blade count, ascending
+inline std::vector<size_t> swapRecordIndices(PitchControl mode, int bladeCount)
+{
+    std::vector<size_t> result;
+    for (const auto& record : swapInputRecords)
+        if (appliesTo(record, mode, bladeCount))
+            result.push_back(record.index);
+    for (const auto& record : swapOutputRecords)
+        if (appliesTo(record, mode, bladeCount))
+            result.push_back(record.index);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+template<PitchControl mode, int bladeCount, size_t I>
+inline void packRecord(const SwapInputValues& inputs, const SwapScales& scales, float* avrSwap)
+{
+    constexpr SwapRecord<SwapInput> record = swapInputRecords[I];
+    if constexpr (appliesTo(record, mode, bladeCount))
+    {
+        // convert between 1-based FORTRAN indexing and 0-based C++ indexing
+        if constexpr (record.value == SwapInput::constant)
+            avrSwap[record.index - 1] = static_cast<float>(record.factor);
+        else
+            avrSwap[record.index - 1] = static_cast<float>(inputs[record.value] * record.factor / scales[record.scale]);
+    }
+}
+
+template<PitchControl mode, int bladeCount, size_t I>
+inline void unpackRecord(const float* avrSwap, const SwapScales& scales, SwapOutputValues& outputs)
+{
+    constexpr SwapRecord<SwapOutput> record = swapOutputRecords[I];
+    if constexpr (appliesTo(record, mode, bladeCount))
+        outputs[record.value] = avrSwap[record.index - 1] / record.factor * scales[record.scale];
+}
+
+template<PitchControl mode, int bladeCount>
+void packSwapRecords(const SwapInputValues& inputs, const SwapScales& scales, float* avrSwap)
+{
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (packRecord<mode, bladeCount, I>(inputs, scales, avrSwap), ...);
+    }(std::make_index_sequence<std::size(swapInputRecords)>());
+}
+
+template<PitchControl mode, int bladeCount>
+void unpackSwapRecords(const float* avrSwap, const SwapScales& scales, SwapOutputValues& outputs)
+{
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (unpackRecord<mode, bladeCount, I>(avrSwap, scales, outputs), ...);
+    }(std::make_index_sequence<std::size(swapOutputRecords)>());
+}
+
+typedef void (*SwapPackFunc)(const SwapInputValues&, const SwapScales&, float*);
+typedef void (*SwapUnpackFunc)(const float*, const SwapScales&, SwapOutputValues&);
+
+struct SwapKernels
+{
+    SwapPackFunc pack;
+    SwapUnpackFunc unpack;
+};
+
+template<PitchControl mode, int bladeCount>
+constexpr SwapKernels swapKernels()
+{
+    return { packSwapRecords<mode, bladeCount>, unpackSwapRecords<mode, bladeCount> };
+}
+
+// common pitch control always controls a single blade, individual control up to three
+inline SwapKernels swapKernels(bool commonBladeControl, int controlledBladeCount)
+{
+    if (commonBladeControl)
+        return swapKernels<PitchControl::common, 1>();
+    switch (controlledBladeCount)
+    {
+        case 1:
+            return swapKernels<PitchControl::individual, 1>();
+        case 2:
+            return swapKernels<PitchControl::individual, 2>();
+        default:
+            return swapKernels<PitchControl::individual, 3>();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* A fixed set of worker threads for running a batch of independent tasks, with the calling thread taking part.
+   Running a batch makes no heap allocations, so it can be used from a controller step. Batches run from several
+   threads take turns. */
+class ThreadPool
+{
+public:
+    typedef void (*Task)(void* context, size_t index);
+
+    explicit ThreadPool(unsigned workerCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // the workers and the calling thread
+    size_t threadCount() const { return workers.size() + 1; }
+
+    // calls task(context, index) for each index in [0, count) and returns once all calls have completed
+    void run(size_t count, Task task, void* context);
+
+    template<typename F>
+    void run(size_t count, F& f)
+    {
+        run(count, [](void* context, size_t index) { (*static_cast<F*>(context))(index); }, &f);
+    }
+private:
+    void work();
+    void runTasks();
+private:
+    std::vector<std::thread> workers;
+    std::mutex runMutex; // held for the whole of a batch
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    bool stopping = false;
+    unsigned generation = 0;
+    unsigned busyWorkers = 0;
+    Task task = nullptr;
+    void* context = nullptr;
+    size_t count = 0;
+    std::atomic<size_t> nextIndex = 0;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include "OrcFxAPI.h"
+#include "OrcFxAPI_wrapper.hpp"
+
+using namespace Orcina;
+
+/* Collects a set of instantaneous time history values so that they can be fetched with a single call to
+   C_GetMultipleTimeHistories. Variable IDs and object extra structures are resolved when results are added,
+   so fetch() does no string lookups and no allocation. */
+class TimeHistoryBatch
+{
+public:
+    TimeHistoryBatch();
+    int add(const OrcaFlexObject& modelObject, const std::wstring& varName);
+    int add(const OrcaFlexObject& modelObject, const std::wstring& varName, const ObjectExtra& objectExtra);
+    TObjectExtra2& objectExtra(int index);
+    int append(const TimeHistoryBatch& other); // shares other's object extras, returns the index of its first result
+    void assignValues(const TimeHistoryBatch& source, int offset); // values fetched by a batch this was appended to
+    void fetch();
+    double value(int index) const { return values[index]; };
+    int size() const { return static_cast<int>(specification.size()); };
+private:
+    int add(const OrcaFlexObject& modelObject, const std::wstring& varName, TObjectExtra2* objectExtra);
+private:
+    TPeriod period;
+    std::deque<ObjectExtra> objectExtras; // owns the strings referenced by apiObjectExtras
+    std::deque<TObjectExtra2> apiObjectExtras;
+    std::vector<TTimeHistorySpecification> specification;
+    std::vector<double> values;
+};
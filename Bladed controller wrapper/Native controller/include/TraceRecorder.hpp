@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "PhaseTimer.hpp"
+
+/* A timeline of controller phases across turbines and threads, written as Chrome trace event JSON for Perfetto
+   or chrome://tracing when the last traced controller is finalised. Events go into one buffer, allocated when
+   tracing starts, that threads claim in blocks with an atomic increment and then fill without locking. Once
+   the buffer is used up, further events are dropped and counted. */
+class TraceSession
+{
+public:
+    // the open session, or a new one writing to fileName with room for eventBudget events
+    static std::shared_ptr<TraceSession> join(const std::filesystem::path& fileName, size_t eventBudget);
+
+    TraceSession(const std::filesystem::path& fileName, size_t eventBudget);
+    ~TraceSession();
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+    const std::filesystem::path& fileName() const { return path; };
+    uint32_t addTurbine(const std::wstring& name);
+    void record(uint64_t ticks, double simulationTime, uint32_t turbine, Phase phase, bool begin) noexcept;
+private:
+    struct Event
+    {
+        uint64_t ticks;
+        double simulationTime;
+        uint32_t turbine;
+        Phase phase;
+        bool begin;
+    };
+
+    struct Block
+    {
+        std::atomic<uint32_t> count = 0; // published with release once each event is written
+        uint32_t thread = 0;
+    };
+
+    static constexpr uint32_t blockSize = 1024;
+
+    // the calling thread's block with room for another event, nullptr if the budget is used up
+    Block* claim(size_t& blockIndex);
+    void write() const;
+private:
+    static std::mutex sessionMutex;
+    static std::weak_ptr<TraceSession> openSession;
+    static std::atomic<uint64_t> sessionCount;
+
+    std::filesystem::path path;
+    uint64_t generation;
+    size_t blockCount;
+    std::unique_ptr<Event[]> events;
+    std::unique_ptr<Block[]> blocks;
+    std::atomic<size_t> nextBlock = 0;
+    std::atomic<uint32_t> threadCount = 0;
+    std::atomic<uint64_t> dropped = 0;
+    std::mutex turbinesMutex;
+    std::vector<std::wstring> turbines;
+    uint64_t startTicks;
+    std::chrono::steady_clock::time_point startTime;
+};
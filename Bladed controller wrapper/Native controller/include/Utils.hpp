@@ -1,12 +1,15 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <stdexcept>
 #include <sstream>
 #include <cmath>
 #include <numbers>
 #include "OrcFxAPI.h"
+#include "OrcFxAPI_wrapper.hpp"
+#include "Platform.hpp"
 
 using namespace Orcina;
 
@@ -14,8 +17,6 @@ enum class ControlledVar { pitch, torque };
 
 void print(const std::wstring text);
 bool checkStatus(TExtFnInfo& info, const std::wstring context, int status);
-std::string utf16ToUtf8(const std::wstring& value);
-std::wstring utf8ToUtf16(const std::string value);
 std::wstring trim(const std::wstring& str);
 double radians(const double degrees);
 TVector crossProd(const TVector& v1, const TVector& v2);
@@ -23,5 +24,26 @@ TVector sum(const TVector& v1, const TVector& v2);
 TVector prod(const TMatrix& m, const TVector& v);
 bool isZero(const TVector& v);
 double suppressRangeJumps(const double previous, const double value);
-ControlledVar controlledVar(const std::wstring dataName);
-bool TryStrToDouble(const std::string& text, double& value);
\ No newline at end of file
+ControlledVar controlledVar(const std::wstring_view dataName);
+bool TryStrToDouble(const std::string& text, double& value);
+
+// a tag of False or True, false if the tag is not defined
+bool getBoolFromTag(const OrcaFlexObject& modelObject, const std::wstring& name);
+// a numeric tag, which must be defined
+double getDoubleFromTag(const OrcaFlexObject& modelObject, const std::wstring& name);
+
+/* Diagnostic output written as a simulation finishes, such as the timing summary, a trace or a recording, is
+   not worth failing the simulation's finalisation for, so an error writing it is printed to the external
+   function output window rather than thrown. */
+template<typename F>
+void writeDiagnostic(const std::wstring& description, F write)
+{
+    try
+    {
+        write();
+    }
+    catch (const std::exception& exc)
+    {
+        print(L"Could not write " + description + L": " + utf8ToUtf16(exc.what()) + L"\n");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef _posix_windows_
+#define _posix_windows_
+
+/* The subset of the Win32 API used by OrcFxAPI.h and OrcFxAPIExplicitLink.c, mapped onto POSIX so that the
+   wrapper can be built as a Linux shared object. Only on the include path for non-Windows builds; the rest of
+   the wrapper uses Platform.hpp rather than Win32 directly. */
+
+#include <stdint.h>
+#include <wchar.h>
+#include <dlfcn.h>
+
+#define __stdcall
+#define __cdecl
+
+typedef int BOOL;
+typedef uint32_t DWORD;
+typedef DWORD* LPDWORD;
+typedef DWORD COLORREF;
+typedef intptr_t INT_PTR;
+typedef uintptr_t UINT_PTR;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef wchar_t* LPWSTR;
+typedef const wchar_t* LPCWSTR;
+typedef void* HMODULE;
+typedef void* HWND;
+typedef void* HBITMAP;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+// the OrcFxAPI module handle passed to InitializeOrcFxAPI is a dlopen handle
+static inline void* GetProcAddress(HMODULE module, const char* name)
+{
+    return dlsym(module, name);
+}
+
+#endif /* !_posix_windows_ */
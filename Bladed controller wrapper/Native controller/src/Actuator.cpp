@@ -1,36 +1,277 @@
 #include "Actuator.hpp"
+#include "MatrixExponential.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
 #include <cmath>
 
-Actuator::Actuator(double omega, double gamma, double dt)
-    : omega(omega), gamma(gamma), dt(dt), prevState{0, 0, 0}, uprev(0)
+/* The closed form below divides by sqrt(1 - gamma^2), so critically and over-damped actuators are discretised from
+   the transition of the state augmented with the input and its rate, x'' = omega^2 (u - x) - 2 gamma omega x',
+   u' = udot, found by powering up the transition over a sub-step short enough for a Taylor series. The input ramp
+   is part of the augmented state, so it is followed exactly. */
+static ActuatorCoefficients poweredCoefficients(double omega, double gamma, double dt)
 {
+    double omegaSqr = omega * omega;
+    double gamma2Omega = 2 * gamma * omega;
+    Matrix<4> m{
+        0, dt, 0, 0,
+        -omegaSqr * dt, -gamma2Omega * dt, omegaSqr * dt, 0,
+        0, 0, 0, dt,
+        0, 0, 0, 0
+    };
+    Matrix<4> t = exponential<4>(m); // columns x, xdot, u, udot
+
+    // x is carried as x - u in xdot and xdotdot, and xdotdot is found from the state and input at the step's end
+    return {
+        dt,
+        t[0],
+        t[1],
+        t[3],
+        t[2],
+        t[4],
+        t[5],
+        t[7],
+        -omegaSqr * t[0] - gamma2Omega * t[4],
+        -omegaSqr * t[1] - gamma2Omega * t[5],
+        omegaSqr * (dt - t[3]) - gamma2Omega * t[7]
+    };
+}
+
+ActuatorCoefficients actuatorCoefficients(double omega, double gamma, double dt)
+{
+    if (gamma >= 1)
+        return poweredCoefficients(omega, gamma, dt);
+
     double beta = sqrt(1 - gamma * gamma);
-    g = exp(-gamma * omega * dt) * sin(beta * omega * dt) / (beta * omega);
-    f = exp(-gamma * omega * dt) * (gamma * sin(beta * omega * dt) / beta + cos(beta * omega * dt));
+    double g = exp(-gamma * omega * dt) * sin(beta * omega * dt) / (beta * omega);
+    double f = exp(-gamma * omega * dt) * (gamma * sin(beta * omega * dt) / beta + cos(beta * omega * dt));
+    double omegaSqr = omega * omega;
+    double gamma2Omega = 2 * gamma * omega;
+    return {
+        dt,
+        f,
+        g,
+        2.0 * gamma * (f - 1.0) / omega + dt - g,
+        1.0 - f,
+        -g * omegaSqr,
+        f - gamma2Omega * g,
+        1.0 - f,
+        (gamma2Omega * g - f) * omegaSqr,
+        (4.0 * gamma* gamma - 1.0) * omegaSqr * g - gamma2Omega * f,
+        omegaSqr * g
+    };
+}
+
+Actuator::Actuator(double omega, double gamma, double dt)
+    : omega(omega), gamma(gamma), prevState{0, 0, 0}, uprev(0)
+{
+    cache[0] = actuatorCoefficients(omega, gamma, dt);
 }
 
 ActuatorState Actuator::output(double input)
+{
+    return output(input, cache[0]);
+}
+
+ActuatorState Actuator::output(double input, double dt)
+{
+    return output(input, coefficients(dt));
+}
+
+const ActuatorCoefficients& Actuator::coefficients(double dt)
+{
+    for (size_t i = 0; i < cacheCount; i++)
+        if (sameTimeStep(dt, cache[i].dt))
+            return cache[i];
+
+    // replace the least recently added entry, keeping the first
+    ActuatorCoefficients& entry = cache[nextCacheEntry];
+    entry = actuatorCoefficients(omega, gamma, dt);
+    cacheCount = std::max(cacheCount, nextCacheEntry + 1);
+    nextCacheEntry = nextCacheEntry + 1 < cache.size() ? nextCacheEntry + 1 : 1;
+    return entry;
+}
+
+ActuatorState Actuator::output(double input, const ActuatorCoefficients& c)
 {
     double u = input;
-    double omegaSqr = omega * omega;
-    double gamma2Omega = 2 * gamma * omega;
     double xprev = prevState.x;
     double xdotprev = prevState.xdot;
-    double udot = (u - uprev) / dt;
+    double udot = (u - uprev) / c.dt;
     ActuatorState result{
-        f * xprev
-        + g * xdotprev
-        + (2.0 * gamma * (f - 1.0) / omega + dt - g) * udot
-        + (1.0 - f) * uprev,
-        -g * omegaSqr * (xprev - uprev)
-        + (f - gamma2Omega * g) * xdotprev
-        + (1.0 - f) * udot,
-        (gamma2Omega * g - f) * omegaSqr * (xprev - uprev)
-        + ((4.0 * gamma* gamma - 1.0) * omegaSqr * g - gamma2Omega * f)
-        * xdotprev
-        + omegaSqr * g * udot
+        c.xFromX * xprev + c.xFromXdot * xdotprev + c.xFromUdot * udot + c.xFromU * uprev,
+        c.xdotFromX * (xprev - uprev) + c.xdotFromXdot * xdotprev + c.xdotFromUdot * udot,
+        c.xdotdotFromX * (xprev - uprev) + c.xdotdotFromXdot * xdotprev + c.xdotdotFromUdot * udot
     };
     prevState = result;
     uprev = u;
     return result;
 }
+
+void Actuator::getState(ActuatorState& state, double& input) const
+{
+    state = prevState;
+    input = uprev;
+}
+
+void Actuator::setState(const ActuatorState& state, double input)
+{
+    prevState = state;
+    uprev = input;
+}
+
+namespace {
+
+// one block of a series, stepped from rest and then corrected for its starting state
+struct SeriesBlock
+{
+    size_t begin;
+    size_t end;
+    double startX;
+    double startXdot;
+};
+
+struct SeriesScan
+{
+    const ActuatorCoefficients& c;
+    std::span<const double> input;
+    double firstUprev;
+    std::vector<SeriesBlock> blocks;
+    std::vector<double> x; // from rest, then corrected
+    std::vector<double> xdot;
+    // the state transition over i + 1 steps, A^(i + 1), by element of the 2x2 matrix, up to the step after
+    // which it has decayed to nothing
+    std::vector<double> power00, power01, power10, power11;
+    ActuatorState* output;
+
+    double uprev(size_t i) const
+    {
+        return i == 0 ? firstUprev : input[i - 1];
+    }
+
+    // the response to the block's inputs alone, its state at the end is the block's affine term
+    void stepFromRest(size_t blockIndex)
+    {
+        const SeriesBlock& block = blocks[blockIndex];
+        double xprev = 0;
+        double xdotprev = 0;
+        for (size_t i = block.begin; i < block.end; i++)
+        {
+            double up = uprev(i);
+            double udot = (input[i] - up) / c.dt;
+            double xi = c.xFromX * xprev + c.xFromXdot * xdotprev + c.xFromUdot * udot + c.xFromU * up;
+            double xdoti = c.xdotFromX * (xprev - up) + c.xdotFromXdot * xdotprev + c.xdotFromUdot * udot;
+            x[i] = xprev = xi;
+            xdot[i] = xdotprev = xdoti;
+        }
+    }
+
+    // the response to a state j + 1 steps earlier, which is nothing once the powers are exhausted
+    double responseX(size_t j, double x0, double xdot0) const
+    {
+        return j < power00.size() ? power00[j] * x0 + power01[j] * xdot0 : 0;
+    }
+
+    double responseXdot(size_t j, double x0, double xdot0) const
+    {
+        return j < power10.size() ? power10[j] * x0 + power11[j] * xdot0 : 0;
+    }
+
+    void correct(size_t blockIndex)
+    {
+        const SeriesBlock& block = blocks[blockIndex];
+        const size_t count = std::min(block.end - block.begin, power00.size());
+        double* xi = x.data() + block.begin;
+        double* xdoti = xdot.data() + block.begin;
+        const double x0 = block.startX;
+        const double xdot0 = block.startXdot;
+        for (size_t j = 0; j < count; j++)
+        {
+            xi[j] += power00[j] * x0 + power01[j] * xdot0;
+            xdoti[j] += power10[j] * x0 + power11[j] * xdot0;
+        }
+
+        // xdotdot is not carried from step to step, so it follows from the corrected states
+        double xprev = x0;
+        double xdotprev = xdot0;
+        for (size_t i = block.begin; i < block.end; i++)
+        {
+            double up = uprev(i);
+            double udot = (input[i] - up) / c.dt;
+            output[i] = {
+                x[i],
+                xdot[i],
+                c.xdotdotFromX * (xprev - up) + c.xdotdotFromXdot * xdotprev + c.xdotdotFromUdot * udot
+            };
+            xprev = x[i];
+            xdotprev = xdot[i];
+        }
+    }
+};
+
+}
+
+std::vector<ActuatorState> Actuator::outputSeries(std::span<const double> input, ThreadPool* pool)
+{
+    const size_t minimumBlockLength = 4096;
+    size_t blockCount = pool ? std::min(pool->threadCount(), input.size() / minimumBlockLength) : 0;
+    std::vector<ActuatorState> result(input.size());
+    if (blockCount < 2)
+    {
+        for (size_t i = 0; i < input.size(); i++)
+            result[i] = output(input[i], cache[0]);
+        return result;
+    }
+
+    SeriesScan scan{ cache[0], input, uprev, {}, {}, {}, {}, {}, {}, {}, result.data() };
+    size_t blockLength = (input.size() + blockCount - 1) / blockCount;
+    for (size_t begin = 0; begin < input.size(); begin += blockLength)
+        scan.blocks.push_back({ begin, std::min(begin + blockLength, input.size()), 0, 0 });
+    scan.x.resize(input.size());
+    scan.xdot.resize(input.size());
+
+    // powers of the transition, which decay, and are cut off once they could not affect a result
+    const ActuatorCoefficients& c = cache[0];
+    double p00 = c.xFromX, p01 = c.xFromXdot, p10 = c.xdotFromX, p11 = c.xdotFromXdot;
+    for (size_t j = 0; j < blockLength; j++)
+    {
+        if (std::max({ std::abs(p00), std::abs(p01), std::abs(p10), std::abs(p11) }) < 1e-200)
+            break;
+        scan.power00.push_back(p00);
+        scan.power01.push_back(p01);
+        scan.power10.push_back(p10);
+        scan.power11.push_back(p11);
+        double next00 = c.xFromX * p00 + c.xFromXdot * p10;
+        double next01 = c.xFromX * p01 + c.xFromXdot * p11;
+        double next10 = c.xdotFromX * p00 + c.xdotFromXdot * p10;
+        double next11 = c.xdotFromX * p01 + c.xdotFromXdot * p11;
+        p00 = next00;
+        p01 = next01;
+        p10 = next10;
+        p11 = next11;
+    }
+
+    auto stepFromRest = [&](size_t blockIndex) { scan.stepFromRest(blockIndex); };
+    pool->run(scan.blocks.size(), stepFromRest);
+
+    // each block starts where the one before ends: its end from rest plus the response to its own start
+    double x0 = prevState.x;
+    double xdot0 = prevState.xdot;
+    for (SeriesBlock& block : scan.blocks)
+    {
+        block.startX = x0;
+        block.startXdot = xdot0;
+        size_t last = block.end - 1;
+        size_t j = block.end - block.begin - 1;
+        double xEnd = scan.x[last] + scan.responseX(j, x0, xdot0);
+        double xdotEnd = scan.xdot[last] + scan.responseXdot(j, x0, xdot0);
+        x0 = xEnd;
+        xdot0 = xdotEnd;
+    }
+
+    auto correct = [&](size_t blockIndex) { scan.correct(blockIndex); };
+    pool->run(scan.blocks.size(), correct);
+
+    prevState = result.back();
+    uprev = input.back();
+    return result;
+}
@@ -0,0 +1,102 @@
+#include "ActuatorBank.hpp"
+#include <limits>
+
+// the coefficients of ActuatorCoefficients other than dt
+constexpr size_t coefficientCount = 10;
+static_assert(sizeof(ActuatorCoefficients) == (coefficientCount + 1) * sizeof(double));
+
+ActuatorBank::ActuatorBank()
+{
+    cachedDt.fill(std::numeric_limits<double>::quiet_NaN());
+}
+
+size_t ActuatorBank::add(double omega, double gamma)
+{
+    this->omega.push_back(omega);
+    this->gamma.push_back(gamma);
+    x.push_back(0);
+    xdot.push_back(0);
+    xdotdot.push_back(0);
+    uprev.push_back(0);
+
+    // the layout depends on the number of actuators, so the cache starts again
+    for (size_t entry = 0; entry < cacheSize; entry++)
+    {
+        cachedDt[entry] = std::numeric_limits<double>::quiet_NaN();
+        cachedCoefficients[entry].resize(coefficientCount * x.size());
+    }
+    return x.size() - 1;
+}
+
+size_t ActuatorBank::cacheEntry(double dt)
+{
+    for (size_t entry = 0; entry < cacheSize; entry++)
+        if (sameTimeStep(dt, cachedDt[entry]))
+            return entry;
+
+    size_t entry = nextCacheEntry;
+    nextCacheEntry = (nextCacheEntry + 1) % cacheSize;
+    const size_t count = x.size();
+    double* result = cachedCoefficients[entry].data();
+    for (size_t i = 0; i < count; i++)
+    {
+        ActuatorCoefficients c = actuatorCoefficients(omega[i], gamma[i], dt);
+        const double values[coefficientCount] = {
+            c.xFromX, c.xFromXdot, c.xFromUdot, c.xFromU, c.xdotFromX, c.xdotFromXdot, c.xdotFromUdot,
+            c.xdotdotFromX, c.xdotdotFromXdot, c.xdotdotFromUdot
+        };
+        for (size_t k = 0; k < coefficientCount; k++)
+            result[k * count + i] = values[k];
+    }
+    cachedDt[entry] = dt;
+    return entry;
+}
+
+/* A free function, with each array passed as a separate non-aliasing pointer, is what the compilers need in order
+   to vectorise the loop; the same loop over the members is left scalar. */
+static void step(size_t count, const double* __restrict input, double dt,
+    const double* __restrict xFromX, const double* __restrict xFromXdot, const double* __restrict xFromUdot,
+    const double* __restrict xFromU, const double* __restrict xdotFromX, const double* __restrict xdotFromXdot,
+    const double* __restrict xdotFromUdot, const double* __restrict xdotdotFromX,
+    const double* __restrict xdotdotFromXdot, const double* __restrict xdotdotFromUdot,
+    double* __restrict x, double* __restrict xdot, double* __restrict xdotdot, double* __restrict uprev)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        double u = input[i];
+        double xprev = x[i];
+        double xdotprev = xdot[i];
+        double udot = (u - uprev[i]) / dt;
+        double xRelative = xprev - uprev[i];
+        x[i] = xFromX[i] * xprev + xFromXdot[i] * xdotprev + xFromUdot[i] * udot + xFromU[i] * uprev[i];
+        xdot[i] = xdotFromX[i] * xRelative + xdotFromXdot[i] * xdotprev + xdotFromUdot[i] * udot;
+        xdotdot[i] = xdotdotFromX[i] * xRelative + xdotdotFromXdot[i] * xdotprev + xdotdotFromUdot[i] * udot;
+        uprev[i] = u;
+    }
+}
+
+void ActuatorBank::output(const double* input, double dt)
+{
+    const size_t count = x.size();
+    if (count == 0)
+        return;
+    // the step uses the cached time step, so that steps that differ only by round-off give identical results
+    size_t entry = cacheEntry(dt);
+    const double* c = cachedCoefficients[entry].data();
+    step(count, input, cachedDt[entry], c, c + count, c + 2 * count, c + 3 * count, c + 4 * count, c + 5 * count,
+        c + 6 * count, c + 7 * count, c + 8 * count, c + 9 * count, x.data(), xdot.data(), xdotdot.data(), uprev.data());
+}
+
+void ActuatorBank::getState(size_t index, ActuatorState& state, double& input) const
+{
+    state = this->state(index);
+    input = uprev[index];
+}
+
+void ActuatorBank::setState(size_t index, const ActuatorState& state, double input)
+{
+    x[index] = state.x;
+    xdot[index] = state.xdot;
+    xdotdot[index] = state.xdotdot;
+    uprev[index] = input;
+}
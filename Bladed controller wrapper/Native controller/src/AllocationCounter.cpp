@@ -0,0 +1,48 @@
+#include "AllocationCounter.hpp"
+
+#ifdef CHECK_STEP_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+static thread_local size_t count = 0;
+
+size_t allocationCount()
+{
+    return count;
+}
+
+void* operator new(size_t size)
+{
+    count++;
+    if (void* result = std::malloc(size ? size : 1))
+        return result;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
@@ -0,0 +1,222 @@
+#include "BaselineController.hpp"
+#include "StateSnapshot.hpp"
+#include "Utils.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+// the same layout as the Python stored state: tag, version, nine engine values, then the actuator's input and state
+static const char stateTag[5] = "NRCS";
+static const uint32_t stateVersion = 1;
+
+static const double cornerFreq = 1.570796;
+static const double targetSpeed = 122.9096; // rad/s
+static const double minPitch = 0.0; // rad
+static const double maxPitch = std::numbers::pi / 2.0; // rad
+static const double maxPitchRate = 0.1396263; // rad/s
+static const double thetak = 0.1099965; // rad
+static const double ctInSpeed = 70.16224; // transitional generator speed between regions 1 and 1 1/2, rad/s
+static const double maxTorqueRate = 1.5e4; // N.m/s
+static const double maxTorque = 47402.91; // N.m
+static const double rgn2K = 2.332287; // torque constant in region 2, N.m/(rad/s)^2
+static const double rgn2Speed = 91.21091; // transition speed between regions 1 1/2 and 2, rad/s
+// min pitch at which torque is computed in region 3 regardless of gen speed, rad (chosen to be 1.0deg above min pitch)
+static const double rgn3minPitch = 0.01745329;
+static const double genTargetSpeed = 121.6805; // rated generator speed rad/s (chosen to be 99% of targetSpeed)
+// Watts (chosen to be 5MW divided by the electrical generator efficiency of 94.4%)
+static const double ratedPower = 5296610.0;
+static const double slipPercent = 10.0; // rated generator slip percentage in region 2 1/2
+static const double sySpeed = genTargetSpeed / (1.0 + 0.01 * slipPercent);
+
+BaselineController::BaselineController(TExtFnInfo& info)
+{
+    OrcaFlexObject turbine(info.ObjectHandle);
+    if (turbine.getType() != otTurbine)
+        throw std::runtime_error("External function must be associated with a turbine object.");
+    if (!turbine.DataNameValid(L"PitchControlMode"))
+        throw std::runtime_error("Wrapper only supports OrcaFlex v11.0a and later.");
+    if (turbine.GetDataDouble(L"InitialPitch", 0) != 0.0)
+        throw std::runtime_error("Initial blade pitch must be zero.");
+    if (turbine.GetDataString(L"PitchControlMode") != L"Common")
+        throw std::runtime_error("Must use common pitch control mode.");
+
+    OrcaFlexModel model(info.ModelHandle);
+    OrcaFlexObject general = model.getGeneral();
+    setTimeStep(general);
+
+    useActuator = getBoolFromTag(turbine, L"UseActuator");
+    floatingSystem = getBoolFromTag(turbine, L"FloatingSystem");
+    momentScaleFactor = turbine.UnitsConversionFactor(L"FF.LL");
+
+    if (useActuator)
+        actuator = std::make_unique<Actuator>(getDoubleFromTag(turbine, L"ActuatorOmega"), getDoubleFromTag(turbine, L"ActuatorGamma"), dt);
+
+    if (!floatingSystem)
+    {
+        kp = 0.01882681;
+        ki = 0.008068634;
+    }
+    else
+    {
+        kp = 0.006275604;
+        ki = 0.0008965149;
+    }
+
+    slope15 = rgn2K * rgn2Speed * rgn2Speed / (rgn2Speed - ctInSpeed);
+    if (!floatingSystem)
+        slope25 = (ratedPower / genTargetSpeed) / (genTargetSpeed - sySpeed);
+    else
+        slope25 = (ratedPower / targetSpeed) / (genTargetSpeed - sySpeed);
+
+    if (rgn2K == 0.0)
+        trGnSp = sySpeed;
+    else
+        trGnSp = (slope25 - sqrt(slope25 * (slope25 - 4.0 * rgn2K * sySpeed))) / (2.0 * rgn2K);
+
+    if (info.lpStateData)
+        restoreState(info.lpStateData, info.LengthOfStateData);
+}
+
+void BaselineController::setTimeStep(OrcaFlexObject& general)
+{
+    int status;
+    C_GetDataDouble(general.getHandle(), L"ActualOuterTimeStep", 0, &dt, &status);
+    if (status == stOK)
+        return;
+
+    // as ControllerEngine, implicit simulations must not vary their time step
+    int variableTimeStep;
+    C_GetDataInteger(general.getHandle(), L"ImplicitUseVariableTimeStep", 0, &variableTimeStep, &status);
+    if (status == stOK && variableTimeStep)
+        throw std::runtime_error("Turbine controllers require a constant time step.");
+
+    C_GetDataDouble(general.getHandle(), L"ImplicitConstantTimeStep", 0, &dt, &status);
+    if (status == stOK)
+        return;
+
+    throw std::runtime_error("Turbine controllers require a constant time step.");
+}
+
+void BaselineController::update(const TExtFnInfo& info)
+{
+    if (!info.NewTimeStep || info.SimulationTime <= lastUpdateTime)
+        return;
+
+    lastUpdateTime = info.SimulationTime;
+
+    const TTurbineInstantaneousCalculationData* const icd =
+        static_cast<const TTurbineInstantaneousCalculationData* const>(info.lpInstantaneousCalculationData);
+
+    double lastPitchCom = pitchCom;
+    double lastTorqueCom = torqueCom;
+    double gainCorrection = 1.0 / (1.0 + lastPitchCom / thetak);
+
+    double pitchNow = icd->BladePitchAngle; // rad
+    double speedNow = icd->GeneratorAngVel; // rad/s
+
+    // apply the filter
+    double alpha = exp(-dt * cornerFreq);
+    filteredSpeed = (1.0 - alpha) * speedNow + alpha * filteredSpeed;
+    double error = filteredSpeed - targetSpeed; // rad
+    errorIntegral += error * dt;
+
+    // pitch control
+
+    // saturate the integral term using the pitch angle limits
+    errorIntegral = std::max(errorIntegral, minPitch / (gainCorrection * ki));
+    errorIntegral = std::min(errorIntegral, maxPitch / (gainCorrection * ki));
+
+    pitchCom = gainCorrection * (kp * error + ki * errorIntegral);
+    pitchCom = std::max(std::min(pitchCom, maxPitch), minPitch); // limit
+
+    // saturate pitch rate and command
+    double pitchRate = (pitchCom - pitchNow) / dt;
+    pitchRate = std::max(std::min(pitchRate, maxPitchRate), -maxPitchRate);
+    pitchCom = pitchNow + pitchRate * dt;
+    pitchCom = std::max(std::min(pitchCom, maxPitch), minPitch); // limit (again)
+
+    // set return values
+    if (useActuator)
+    {
+        ActuatorState actuatorOutput = actuator->output(pitchCom);
+        pitch = actuatorOutput.x;
+        pitchDot = actuatorOutput.xdot;
+        pitchDotDot = actuatorOutput.xdotdot;
+    }
+    else
+    {
+        pitch = pitchCom;
+        pitchDot = 0.0;
+        pitchDotDot = 0.0;
+    }
+
+    // torque control
+
+    if (filteredSpeed >= genTargetSpeed || lastPitchCom >= rgn3minPitch)
+    {
+        if (!floatingSystem)
+            torqueCom = ratedPower / filteredSpeed; // region 3: power is constant
+        else
+            torqueCom = ratedPower / targetSpeed; // region 3: torque is constant for the floating system
+    }
+    else if (filteredSpeed <= ctInSpeed)
+        torqueCom = 0.0; // region 1: torque is zero
+    else if (filteredSpeed < rgn2Speed)
+        torqueCom = slope15 * (filteredSpeed - ctInSpeed); // region 1 1/2: linear ramp in torque from zero to optimal
+    else if (filteredSpeed < trGnSp)
+        torqueCom = rgn2K * filteredSpeed * filteredSpeed; // region 2: optimal torque is proportional to the sqr of the speed
+    else
+        torqueCom = slope25 * (filteredSpeed - sySpeed); // region 2 1/2: simple induction generator transition region
+
+    torqueCom = std::min(torqueCom, maxTorque); // limit
+
+    // saturate torque rate and command
+    double torqueRate = (torqueCom - lastTorqueCom) / dt;
+    torqueRate = std::max(std::min(torqueRate, maxTorqueRate), -maxTorqueRate);
+    torqueCom = lastTorqueCom + torqueRate * dt;
+
+    // torqueCom is in N.m, first convert to OrcaFlex SI units (kN.m) and then to OrcaFlex model units
+    torque = -torqueCom / 1000.0 * momentScaleFactor;
+}
+
+void BaselineController::storeState(TExtFnInfo& info) const
+{
+    StateWriter writer(stateTag, stateVersion);
+    for (double value : { lastUpdateTime, filteredSpeed, pitchCom, torqueCom, errorIntegral, pitch, pitchDot, pitchDotDot, torque })
+        writer.write(value);
+    if (useActuator)
+    {
+        ActuatorState state;
+        double input;
+        actuator->getState(state, input);
+        writer.write(input);
+        writer.write(state);
+    }
+    ::storeState(info, writer);
+}
+
+void BaselineController::restoreState(const void* data, int length)
+{
+    uint32_t version;
+    StateReader reader(data, length, stateTag, version);
+    if (version != stateVersion)
+        throw std::runtime_error("Stored controller state has unsupported version " + std::to_string(version) + ".");
+
+    // the layout has no configuration of its own, the actuator's state is there only if it was in use
+    const size_t headerSize = sizeof(stateTag) - 1 + sizeof(version);
+    const size_t controllerSize = 9 * sizeof(double);
+    const size_t actuatorSize = sizeof(double) + sizeof(ActuatorState);
+    if (static_cast<size_t>(length) != headerSize + controllerSize + (useActuator ? actuatorSize : 0))
+        throw std::runtime_error("Stored controller state does not match the controller's configuration.");
+
+    for (double* value : { &lastUpdateTime, &filteredSpeed, &pitchCom, &torqueCom, &errorIntegral, &pitch, &pitchDot, &pitchDotDot, &torque })
+        reader.read(*value);
+    if (useActuator)
+    {
+        double input = reader.read<double>();
+        actuator->setState(reader.read<ActuatorState>(), input);
+    }
+    if (!reader.atEnd())
+        throw std::runtime_error("Stored controller state has unexpected trailing data.");
+}
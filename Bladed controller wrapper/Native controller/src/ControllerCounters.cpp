@@ -0,0 +1,79 @@
+#include "ControllerCounters.hpp"
+#include "Platform.hpp"
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<uint32_t> segmentCount = 0;
+
+static uint32_t processID()
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+// copies as much of value as fits, always terminated
+static void copyText(char* destination, size_t size, const std::string& value)
+{
+    size_t length = std::min(value.size(), size - 1);
+    memcpy(destination, value.data(), length);
+    destination[length] = 0;
+}
+
+ControllerCounters::ControllerCounters(const std::wstring& turbineName, const std::wstring& modelFileName)
+    : windowStart(std::chrono::steady_clock::now()), windowStartTicks(timestamp())
+{
+    std::string name = controllerCountersPrefix + std::to_string(processID()) + "-" + std::to_string(segmentCount++);
+#ifndef _WIN32
+    // a segment with this name was left by a process that had our ID and did not finish
+    shm_unlink(name.c_str());
+#endif
+    memory = std::make_unique<SharedMemoryBlock>(name, controllerCountersBlockSize());
+    block = new (memory->data()) ControllerCountersBlock{ controllerCountersVersion, processID() };
+    copyText(block->turbineName, sizeof(block->turbineName), utf16ToUtf8(turbineName));
+    copyText(block->modelFileName, sizeof(block->modelFileName), utf16ToUtf8(modelFileName));
+}
+
+void ControllerCounters::publish(double simulationTime, int aviFail, const char* avcMsg)
+{
+    timeSteps++;
+    auto now = std::chrono::steady_clock::now();
+
+    uint32_t sequence = block->sequence.load(std::memory_order_relaxed);
+    block->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ControllerCounterValues& values = block->values;
+    double elapsed = std::chrono::duration<double>(now - windowStart).count();
+    if (elapsed >= 1)
+    {
+        uint64_t ticks = timestamp();
+        values.ticksPerSecond = (ticks - windowStartTicks) / elapsed;
+        values.stepsPerSecond = (timeSteps - windowStartSteps) / elapsed;
+        windowStart = now;
+        windowStartTicks = ticks;
+        windowStartSteps = timeSteps;
+    }
+    values.timeSteps = timeSteps;
+    values.disconCalls = disconCalls.load(std::memory_order_relaxed);
+    values.disconTicks = disconTicks.load(std::memory_order_relaxed);
+    values.sensorTicks = sensorTicks.load(std::memory_order_relaxed);
+    values.simulationTime = simulationTime;
+    values.updateTime = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    values.aviFail = aviFail;
+    size_t length = strnlen(avcMsg, STRINGLENGTH - 1);
+    memcpy(values.avcMsg, avcMsg, length);
+    values.avcMsg[length] = 0;
+
+    block->sequence.store(sequence + 2, std::memory_order_release);
+}
@@ -0,0 +1,74 @@
+#include "ControllerResults.hpp"
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// the results logged by the external function controlling var, in table order
+static std::vector<const ControllerResultInfo*> functionResults(ControlledVar var)
+{
+    std::vector<const ControllerResultInfo*> result;
+    for (const ControllerResultInfo& item : controllerResults)
+        if (item.var == var)
+            result.push_back(&item);
+    return result;
+}
+
+void registerControllerResults(TExtFnInfo& info)
+{
+    for (const ControllerResultInfo* item : functionResults(controlledVar(info.lpDataName)))
+    {
+        TExtFnResultInfo resultInfo = { sizeof(TExtFnResultInfo), static_cast<int>(item->id), item->name, item->units };
+        int status;
+        C_RegisterExternalFunctionResult(&info, &resultInfo, &status);
+        if (!checkStatus(info, L"Call to C_RegisterExternalFunctionResult from eaRegisterResults", status))
+            return;
+    }
+}
+
+void logControllerResults(TExtFnInfo& info, const ControllerResultValues& values)
+{
+    ControlledVar var = controlledVar(info.lpDataName);
+    std::vector<const ControllerResultInfo*> results = functionResults(var);
+    size_t size = sizeof(LoggedResultsHeader) + results.size() * sizeof(double);
+    char* buffer = new char[size];
+    LoggedResultsHeader header = { loggedResultsVersion, static_cast<uint32_t>(var), static_cast<uint32_t>(results.size()), 0 };
+    memcpy(buffer, &header, sizeof(header));
+    for (size_t i = 0; i < results.size(); i++)
+        memcpy(buffer + sizeof(header) + i * sizeof(double), &values[static_cast<size_t>(results[i]->id)], sizeof(double));
+    info.lpLogData = buffer;
+    info.LengthOfLogData = static_cast<int>(size);
+}
+
+void destroyLoggedResults(TExtFnInfo& info)
+{
+    delete[] static_cast<char*>(info.lpLogData);
+    info.lpLogData = nullptr;
+    info.LengthOfLogData = 0;
+}
+
+void deriveControllerResult(TExtFnInfo& info)
+{
+    if (info.ResultID < 0 || info.ResultID >= static_cast<int>(controllerResultCount))
+        throw std::runtime_error("Unrecognised controller result.");
+    const ControllerResultInfo& item = controllerResults[info.ResultID];
+
+    // the position of the result among those its external function logs
+    size_t position = 0;
+    for (int i = 0; i < info.ResultID; i++)
+        if (controllerResults[i].var == item.var)
+            position++;
+
+    LoggedResultsHeader header;
+    size_t length = info.LengthOfLogData > 0 ? static_cast<size_t>(info.LengthOfLogData) : 0;
+    if (!info.lpLogData || length < sizeof(header))
+        throw std::runtime_error("Controller results were not logged.");
+    memcpy(&header, info.lpLogData, sizeof(header));
+    if (header.version != loggedResultsVersion || length < sizeof(header) + header.count * sizeof(double))
+        throw std::runtime_error("Controller results were logged by a different version of the wrapper.");
+    if (header.var != static_cast<uint32_t>(item.var) || position >= header.count)
+        throw std::runtime_error(utf16ToUtf8(item.name) + " is not a result of this external function.");
+    double value;
+    memcpy(&value, static_cast<const char*>(info.lpLogData) + sizeof(header) + position * sizeof(double), sizeof(value));
+    info.Value = value;
+}
@@ -0,0 +1,188 @@
+#include "DisconHost.hpp"
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* number of polls before a waiter goes to sleep, of the order of 100us which covers a typical DISCON call;
+   on a single processor spinning only delays the other side so we sleep straight away */
+static const int spinCount = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+
+static inline void cpuRelax()
+{
+#ifdef _WIN32
+    YieldProcessor();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+#ifdef _WIN32
+static std::wstring widen(const std::string& name)
+{
+    return std::wstring(name.begin(), name.end()); // names are ASCII
+}
+#endif
+
+std::string disconHostEventName(const std::string& blockName, uint32_t slotIndex, const char* direction)
+{
+    return blockName + "-" + std::to_string(slotIndex) + "-" + direction;
+}
+
+// SharedMemoryBlock
+
+SharedMemoryBlock::SharedMemoryBlock(const std::string& name, size_t size)
+    : name(name), size(size), owner(true)
+{
+#ifdef _WIN32
+    handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), widen(name).c_str());
+    if (!handle)
+        throw std::runtime_error("Could not create shared memory " + name + ".");
+    address = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!address)
+    {
+        CloseHandle(handle);
+        throw std::runtime_error("Could not map shared memory " + name + ".");
+    }
+#else
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1)
+        throw std::runtime_error("Could not create shared memory " + name + ".");
+    if (ftruncate(fd, size) == -1)
+    {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not size shared memory " + name + ".");
+    }
+    address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        address = nullptr;
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not map shared memory " + name + ".");
+    }
+#endif
+}
+
+SharedMemoryBlock::SharedMemoryBlock(const std::string& name)
+    : name(name), owner(false)
+{
+#ifdef _WIN32
+    handle = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, widen(name).c_str());
+    if (!handle)
+        throw std::runtime_error("Could not open shared memory " + name + ".");
+    address = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!address)
+    {
+        CloseHandle(handle);
+        throw std::runtime_error("Could not map shared memory " + name + ".");
+    }
+#else
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd == -1)
+        throw std::runtime_error("Could not open shared memory " + name + ".");
+    struct stat info;
+    if (fstat(fd, &info) == -1)
+    {
+        close(fd);
+        throw std::runtime_error("Could not query shared memory " + name + ".");
+    }
+    size = info.st_size;
+    address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        address = nullptr;
+        throw std::runtime_error("Could not map shared memory " + name + ".");
+    }
+#endif
+}
+
+SharedMemoryBlock::~SharedMemoryBlock()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(address);
+    CloseHandle(handle);
+#else
+    munmap(address, size);
+    if (owner)
+        shm_unlink(name.c_str());
+#endif
+}
+
+// DisconHostSignal
+
+DisconHostSignal::DisconHostSignal(std::atomic<uint32_t>& word, std::atomic<uint32_t>& waiting, const std::string& eventName)
+    : word(word), waiting(waiting)
+{
+#ifdef _WIN32
+    // auto-reset, created by whichever side gets there first and opened by the other
+    event = CreateEventW(nullptr, FALSE, FALSE, widen(eventName).c_str());
+    if (!event)
+        throw std::runtime_error("Could not create event " + eventName + ".");
+#endif
+}
+
+DisconHostSignal::~DisconHostSignal()
+{
+#ifdef _WIN32
+    CloseHandle(event);
+#endif
+}
+
+void DisconHostSignal::post(uint32_t value)
+{
+    // sequentially consistent so that either we see the waiter's flag, or the waiter sees the new value
+    word.store(value, std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_seq_cst))
+        wake();
+}
+
+bool DisconHostSignal::waitChange(uint32_t last, int timeoutMilliseconds)
+{
+    for (int i = 0; i < spinCount; i++)
+    {
+        if (word.load(std::memory_order_acquire) != last)
+            return true;
+        cpuRelax();
+    }
+
+    waiting.store(1, std::memory_order_seq_cst);
+    if (word.load(std::memory_order_seq_cst) == last)
+        sleep(last, timeoutMilliseconds);
+    waiting.store(0, std::memory_order_relaxed);
+    return word.load(std::memory_order_acquire) != last;
+}
+
+void DisconHostSignal::sleep(uint32_t current, int timeoutMilliseconds)
+{
+#ifdef _WIN32
+    WaitForSingleObject(event, timeoutMilliseconds);
+#else
+    // returns immediately if the word no longer holds current, wakeups may be spurious and are rechecked by the caller
+    struct timespec timeout = { timeoutMilliseconds / 1000, (timeoutMilliseconds % 1000) * 1000000L };
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, current, &timeout, nullptr, 0);
+#endif
+}
+
+void DisconHostSignal::wake()
+{
+#ifdef _WIN32
+    SetEvent(event);
+#else
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
@@ -1,30 +1,75 @@
-#include <windows.h>
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 #include <vector>
 #include <limits>
 #include <sstream>
 #include <cmath>
+#include <cstddef>
+#include <cstring>
 #include <filesystem>
 #include <memory>
+#include <array>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <numbers>
 #include "nlohmann/json.hpp"
 #include "OrcFxAPI.h"
 #include "OrcFxAPI_wrapper.hpp"
+#include "Platform.hpp"
 #include "Utils.hpp"
-#include "Actuator.hpp"
-
-#define STRINGLENGTH 1024
+#include "ActuatorBank.hpp"
+#include "BaselineController.hpp"
+#include "ControllerCounters.hpp"
+#include "ControllerResults.hpp"
+#include "AllocationCounter.hpp"
+#include "LibraryCopy.hpp"
+#include "LibraryMemory.hpp"
+#include "PhaseTimer.hpp"
+#include "RemoteDiscon.hpp"
+#include "StateSnapshot.hpp"
+#include "StateSpaceActuator.hpp"
+#include "SwapLog.hpp"
+#include "SwapRecording.hpp"
+#include "SwapRecords.hpp"
+#include "ThreadPool.hpp"
+#include "TimeHistoryBatch.hpp"
+#include "TraceRecorder.hpp"
 
 using namespace Orcina;
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
 const wchar_t controllerKeyName[] = L"BladedController";
+const wchar_t baselineControllerKeyName[] = L"NREL5MWController";
+
+const char stateTag[5] = "BCWC";
+const uint32_t stateVersion = 3; // 2 added DISCON memory, 3 state-space actuators
 
 typedef void (__cdecl *discon_func)(float*, int*, char*, char*, char*);
 
+enum class OutputHold { zeroOrder, firstOrder };
+
+// the turbine's state packed into avrSwap that OrcaFlex passes in the instantaneous calculation data
+struct TurbineInputs
+{
+    int bladeCount;
+    double generatorSpeed; // rad/s
+    double rotorSpeed; // rad/s
+    double commonPitch; // rad
+    double rotorAzimuth; // rad
+    double hubWindSpeed;
+    double noddingAcceleration; // translational, at AccelRefPosRrtTurbine
+    double noddingAngularAcceleration; // rad/s^2
+};
+
+class FarmGroup;
+
 class Controller
 {
+    friend class FarmGroup;
 public:
     Controller(TExtFnInfo& info)
         : model(info.ModelHandle), turbine(info.ObjectHandle), general(model.getGeneral()),
@@ -33,6 +78,8 @@ public:
         try
         {
             initialise(info);
+            if (info.lpStateData)
+                restoreState(info.lpStateData, info.LengthOfStateData);
         }
         catch(const std::exception& exc)
         {
@@ -43,8 +90,12 @@ public:
 
     ~Controller()
     {
-        if (!firstCall)
+        reportTiming();
+        leaveFarmGroup();
+        if (disconStarted)
             finalise();
+        if (recorder)
+            writeDiagnostic(L"the controller recording", [this] { recorder->flush(); });
         unloadDll();
     }
 
@@ -55,8 +106,19 @@ public:
 
         setControlledBladeCount();
 
+        initialiseSensors();
+
         dllCanBeShared = getBoolFromTag(turbine, L"ControllerDLLCanBeShared");
         useActuator = getBoolFromTag(turbine, L"UseActuator");
+        snapshotMemory = getBoolFromTag(turbine, L"ControllerMemorySnapshot");
+        if (getBoolFromTag(turbine, L"ControllerTiming"))
+            timing.enable();
+        startTracing();
+        if (getBoolFromTag(turbine, L"ControllerCounters"))
+        {
+            counters = std::make_unique<ControllerCounters>(turbine.getName(), info.lpModelFileName);
+            timing.count(counters.get());
+        }
 
         setAccelRefPosRrtTurbine();
 
@@ -68,12 +130,24 @@ public:
 
         setTimeStep();
 
+        setSamplePeriod();
+
+        initialiseSwapRecords();
+
         if (useActuator)
             createActuators();
 
         loadDll();
 
         initialiseTextArguments(info.lpModelFileName);
+
+        swapInputs[SwapInput::infileLength] = strnlen(accInfile, STRINGLENGTH);
+        swapInputs[SwapInput::outfileLength] = strnlen(avcOutfile, STRINGLENGTH);
+
+        startRecording();
+        startLogging();
+
+        joinFarmGroup(info);
     }
 
     void finalise()
@@ -88,59 +162,155 @@ public:
     {
         if (info.SimulationTime <= lastUpdateTime)
             return;
+        timing.countTimeStep();
+
+        // the time step is taken from successive simulation times, so that variable time steps are followed, and a
+        // step within round-off of the model's time step is taken to be that, so that constant steps are exact
+        if (std::isfinite(lastUpdateTime))
+        {
+            double step = info.SimulationTime - lastUpdateTime;
+            dt = sameTimeStep(step, timeStep) ? timeStep : step;
+        }
+        lastUpdateTime = info.SimulationTime;
+
+        // DISCON is called at its own sample period, which may be longer than the time step, and its outputs are
+        // held in between. A sample is taken at the first time step at or after each sample instant. In a farm
+        // group the group decides, with the time steps it knows of, and a sample it took is always used.
+        double time = info.SimulationTime - simulationStartTime;
+        if (farmGroupSampled(info.SimulationTime))
+            completeGroupSample(time);
+        else if (sampleDue(time))
+            sample(info, time);
+
+        SwapOutputValues outputs = heldOutputs(time);
+
+        // assign state to be returned by external functions, the actuators are stepped every time step
+        {
+            PhaseTimer timer(timing, Phase::actuator);
+            std::array<double, 3> pitchCommand;
+            for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
+                pitchCommand[bladeIndex] = outputs[bladeValue(SwapOutput::pitchCommand1, bladeIndex)];
+            if (useActuator && stateSpaceActuators.empty())
+                actuators.output(pitchCommand.data(), dt);
+            for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
+            {
+                if (useActuator)
+                {
+                    ActuatorState actuatorOutput = stateSpaceActuators.empty() ?
+                        actuators.state(bladeIndex) : stateSpaceActuators[bladeIndex]->output(pitchCommand[bladeIndex], dt);
+                    pitch[bladeIndex] = actuatorOutput.x;
+                    pitchDot[bladeIndex] = actuatorOutput.xdot;
+                    pitchDotDot[bladeIndex] = actuatorOutput.xdotdot;
+                }
+                else
+                {
+                    pitch[bladeIndex] = pitchCommand[bladeIndex];
+                    pitchDot[bladeIndex] = 0;
+                    pitchDotDot[bladeIndex] = 0;
+                }
+            }
+        }
+
+        torque = outputs[SwapOutput::generatorTorque];
+
+        yawDot = outputs[SwapOutput::yawRate];
+        yaw += yawDot * dt;
+
+        if (counters)
+            counters->publish(info.SimulationTime, aviFail, avcMsg);
+    }
+
+    bool sampleDue(double time) const
+    {
+        return firstCall || !hasSamplePeriod || time >= nextSampleTime - 0.5 * dt;
+    }
 
+    void sample(TExtFnInfo& info, double time)
+    {
         const TTurbineInstantaneousCalculationData* const icd =
             static_cast<const TTurbineInstantaneousCalculationData* const>(info.lpInstantaneousCalculationData);
 
-        lastUpdateTime = info.SimulationTime;
+        setSensorPosition(*icd);
+        {
+            PhaseTimer timer(timing, Phase::sensors);
+            if (firstCall)
+                firstCallSensors.fetch();
+            sensors.fetch();
+        }
+        {
+            PhaseTimer timer(timing, Phase::inputs);
+            prepareSample(turbineInputs(*icd), time);
+        }
+        {
+            PhaseTimer timer(timing, Phase::discon);
+            callDll();
+        }
+        PhaseTimer timer(timing, Phase::outputs);
+        completeSample(time);
+    }
+
+    void setSensorPosition(const TTurbineInstantaneousCalculationData& icd)
+    {
+        // the wind direction is sampled at the current turbine position
+        sensors.objectExtra(windDirectionIndex).EnvironmentPos = icd.TurbinePosition;
+    }
+
+    TurbineInputs turbineInputs(const TTurbineInstantaneousCalculationData& icd) const
+    {
+        // "nodding" acceleration
+        TVector accelWrtTurbineRelGlobal = prod(icd.TurbineOrientation, icd.TurbineAcceleration);
+        TVector angAccelWrtTurbineRelGlobal = icd.TurbineAngularAcceleration;
+        if (!isZero(accelRefPosRrtTurbine))
+        {
+            TVector angVelWrtTurbineRelGlobal = icd.TurbineAngularVelocity;
+            // calculate the translational acceleration at the user nominated acceleration reference position.
+            accelWrtTurbineRelGlobal = sum(accelWrtTurbineRelGlobal, crossProd(angAccelWrtTurbineRelGlobal, accelRefPosRrtTurbine));
+            accelWrtTurbineRelGlobal = sum(accelWrtTurbineRelGlobal, crossProd(angVelWrtTurbineRelGlobal, crossProd(angVelWrtTurbineRelGlobal, accelRefPosRrtTurbine)));
+        }
+
+        return TurbineInputs{
+            .bladeCount = icd.BladeCount,
+            .generatorSpeed = icd.GeneratorAngVel,
+            .rotorSpeed = icd.MainShaftAngVel,
+            .commonPitch = icd.BladePitchAngle,
+            .rotorAzimuth = icd.RotorAngle,
+            .hubWindSpeed = icd.HorizontalHubWindSpeed,
+            .noddingAcceleration = accelWrtTurbineRelGlobal.Z, // translational
+            .noddingAngularAcceleration = angAccelWrtTurbineRelGlobal.Y // rotational
+        };
+    }
 
+    // packs avrSwap from fetched sensor values and the turbine's inputs
+    void prepareSample(const TurbineInputs& inputs, double time)
+    {
         if (firstCall)
         {
-            torque = turbine.TimeHistory(L"Generator torque", pnInstantaneousValue)[0];
+            torque = firstCallSensors.value(generatorTorqueIndex);
             yawError = std::numeric_limits<double>::quiet_NaN();
             nacelleYaw = std::numeric_limits<double>::quiet_NaN();
-            setRecord(50, strnlen_s(accInfile, STRINGLENGTH));
-            setRecord(51, strnlen_s(avcOutfile, STRINGLENGTH));
         }
 
         // iStatus
-        setRecord(1, firstCall ? 0 : 1);
+        swapInputs[SwapInput::status] = disconStarted ? 1 : 0;
 
         firstCall = false;
-
-        // length of avcMsg character array
-        setRecord(49, STRINGLENGTH);
+        disconStarted = true;
 
         // number of blades
-        setRecord(61, icd->BladeCount);
+        swapInputs[SwapInput::bladeCount] = inputs.bladeCount;
 
-        // blade pitch
+        // blade pitch, the inputs are in radians whereas time histories are in degrees
         if (commonBladeControl)
-        {
-            double pitch = icd->BladePitchAngle;
-            setRecord(28, 0); // 0 for common control
-            setRecord(4, pitch);
-            setRecord(33, pitch);
-            setRecord(34, pitch);
-        }
+            swapInputs[SwapInput::commonPitch] = inputs.commonPitch;
         else
-        {
-            setRecord(28, 1); // 1 for individual control
             for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
-            {
-                int index = bladeIndex == 0 ? 4 : 33 + bladeIndex - 1;
-                double pitch = radians(
-                    turbine.TimeHistory(L"Blade pitch", pnInstantaneousValue, ObjectExtra::Turbine(1 + bladeIndex))[0]
-                );
-                setRecord(index, pitch);
-            }
-        }
+                swapInputs[bladeValue(SwapInput::bladePitch1, bladeIndex)] = sensors.value(bladePitchIndex[bladeIndex]);
 
         // yaw error
-        double windDirection = environment.TimeHistory(L"Wind direction", pnInstantaneousValue, ObjectExtra::Environment(icd->TurbinePosition))[0];
-        double turbineAzimuth = turbine.TimeHistory(L"Azimuth", pnInstantaneousValue)[0];
+        double windDirection = sensors.value(windDirectionIndex);
+        double turbineAzimuth = sensors.value(azimuthIndex);
         yawError = suppressRangeJumps(yawError, windDirection - turbineAzimuth);
-        setRecord(24, radians(yawError));
+        swapInputs[SwapInput::yawError] = yawError;
 
         // nacelle yaw angle from North
         setAzimuthNorth();
@@ -148,101 +318,92 @@ public:
             nacelleYaw,
             turbineAzimuth - (azimuthNorth - 180)
         );
-        setRecord(37, radians(nacelleYaw));
+        swapInputs[SwapInput::nacelleYaw] = nacelleYaw;
 
         // horizontal hub wind speed
-        setRecord(27, icd->HorizontalHubWindSpeed / velocityScaleFactor);
+        swapInputs[SwapInput::hubWindSpeed] = inputs.hubWindSpeed;
 
         // rotor azimuth angle
-        setRecord(60, icd->RotorAngle);
+        swapInputs[SwapInput::rotorAzimuth] = inputs.rotorAzimuth;
 
         // time
-        setRecord(2, info.SimulationTime - simulationStartTime);
+        swapInputs[SwapInput::time] = time;
 
-        // time step
-        setRecord(3, dt);
+        // time step, i.e. the controller's sample period if it has one and otherwise the current time step
+        swapInputs[SwapInput::timeStep] = hasSamplePeriod ? samplePeriod : dt;
 
         // generator speed
-        setRecord(20, icd->GeneratorAngVel);
+        swapInputs[SwapInput::generatorSpeed] = inputs.generatorSpeed;
 
         // rotor speed
-        setRecord(21, icd->MainShaftAngVel);
+        swapInputs[SwapInput::rotorSpeed] = inputs.rotorSpeed;
 
-        // torque and power, DLL assumed to work in Nm
-        double dllTorque = -torque * 1000 / momentScaleFactor;
-        setRecord(23, dllTorque);
-        setRecord(15, dllTorque * icd->GeneratorAngVel); // power not factored by efficiency
+        // torque and power
+        swapInputs[SwapInput::generatorTorque] = torque;
+        swapInputs[SwapInput::generatorPower] = torque * inputs.generatorSpeed;
 
-        // root in/out of plane bending moment, DLL assumed to work in Nm
+        // root in/out of plane bending moment
         for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
         {
-            ObjectExtra oeBlade = ObjectExtra::Turbine(1 + bladeIndex);
-            double ofMomentEx = turbine.TimeHistory(L"Root connection Ex moment", pnInstantaneousValue, oeBlade)[0];
-            setRecord(69 + bladeIndex, -ofMomentEx * 1000 / momentScaleFactor);
-            double ofMomentEy = turbine.TimeHistory(L"Root connection Ey moment", pnInstantaneousValue, oeBlade)[0];
-            setRecord(30 + bladeIndex, -ofMomentEy * 1000 / momentScaleFactor);
+            swapInputs[bladeValue(SwapInput::rootMomentEx1, bladeIndex)] = sensors.value(rootMomentExIndex[bladeIndex]);
+            swapInputs[bladeValue(SwapInput::rootMomentEy1, bladeIndex)] = sensors.value(rootMomentEyIndex[bladeIndex]);
         }
 
         // "nodding" acceleration
-        TVector accelWrtTurbineRelGlobal = prod(icd->TurbineOrientation, icd->TurbineAcceleration);
-        TVector angAccelWrtTurbineRelGlobal = icd->TurbineAngularAcceleration;
-        if (!isZero(accelRefPosRrtTurbine))
-        {
-            TVector angVelWrtTurbineRelGlobal = icd->TurbineAngularVelocity;
-            // calculate the translational acceleration at the user nominated acceleration reference position.
-            accelWrtTurbineRelGlobal = sum(accelWrtTurbineRelGlobal, crossProd(angAccelWrtTurbineRelGlobal, accelRefPosRrtTurbine));
-            accelWrtTurbineRelGlobal = sum(accelWrtTurbineRelGlobal, crossProd(angVelWrtTurbineRelGlobal, crossProd(angVelWrtTurbineRelGlobal, accelRefPosRrtTurbine)));
-        }
-        setRecord(53, accelWrtTurbineRelGlobal.Z / accelerationScaleFactor); // translational
-        setRecord(83, -angAccelWrtTurbineRelGlobal.Y); // rotational, -ve convert to FAST coordinate system
+        swapInputs[SwapInput::noddingAcceleration] = inputs.noddingAcceleration;
+        swapInputs[SwapInput::noddingAngularAcceleration] = inputs.noddingAngularAcceleration;
 
         // hub moments
-        double ofMomentLy = turbine.TimeHistory(L"Connection Ly moment", pnInstantaneousValue)[0];
-        // assumes: DLL in Nm; ofx turbine Ly = -ve DLL Ly; and DLL load is rotor
-        // side to gen side (whereas ofx connection load is parent to child)
-        setRecord(75, ofMomentLy * 1000 / momentScaleFactor);
+        swapInputs[SwapInput::hubMomentLy] = sensors.value(connectionMomentLyIndex);
+        swapInputs[SwapInput::hubMomentLx] = sensors.value(connectionMomentLxIndex);
 
-        double ofMomentLx = turbine.TimeHistory(L"Connection Lx moment", pnInstantaneousValue)[0];
-        // assumes: DLL in Nm; ofx turbine Lx = DLL Lz; and DLL load is rotor
-        // side to gen side (whereas ofx connection load is parent to child)
-        setRecord(76, -ofMomentLx * 1000 / momentScaleFactor);
+        recordKernels.pack(swapInputs, swapScales, avrSwap);
+    }
 
-        callDll();
+    // unpacks avrSwap once DISCON has been called
+    void completeSample(double time)
+    {
+        bool firstSample = std::isnan(lastSampleTime);
 
         if (aviFail < 0)
             throw std::runtime_error(std::string("Call to DISCON failed:\n") + avcMsg);
+        if (swapLog)
+            swapLog->write(time, avrSwap);
+
+        previousSwapOutputs = swapOutputs;
+        recordKernels.unpack(avrSwap, swapScales, swapOutputs);
+        std::copy(std::begin(avrSwap), std::end(avrSwap), outputRecords.begin());
+        if (firstSample)
+            previousSwapOutputs = swapOutputs;
+
+        lastSampleTime = time;
+        if (firstSample)
+            nextSampleTime = time;
+        while (nextSampleTime <= time + 0.5 * dt)
+            nextSampleTime += samplePeriod;
+    }
 
-        // read output from DISCON and assign state to be returned by external functions
-        pitch.clear();
-        pitchDot.clear();
-        pitchDotDot.clear();
-        for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
-        {
-            double pitchCommand = commonBladeControl ? getRecord(45) : getRecord(42 + bladeIndex);
-            if (useActuator)
-            {
-                ActuatorState actuatorOutput = actuators[bladeIndex].output(pitchCommand);
-                pitch.push_back(actuatorOutput.x);
-                pitchDot.push_back(actuatorOutput.xdot);
-                pitchDotDot.push_back(actuatorOutput.xdotdot);
-            }
-            else
-            {
-                pitch.push_back(pitchCommand);
-                pitchDot.push_back(0);
-                pitchDotDot.push_back(0);
-            }
-        }
-
-        // DLL assumed to return value in Nm, first convert to OrcaFlex SI units (kN.m) and then to OrcaFlex model units
-        torque = -getRecord(47) / 1000 * momentScaleFactor;
-
-        yawDot = getRecord(48);
-        yaw += yawDot * dt;
+    SwapOutputValues heldOutputs(double time)
+    {
+        if (outputHold == OutputHold::zeroOrder)
+            return swapOutputs;
+
+        // first order hold extrapolates from the last two samples
+        double s = (time - lastSampleTime) / samplePeriod;
+        SwapOutputValues result;
+        for (size_t i = 0; i < result.values.size(); i++)
+            result.values[i] = swapOutputs.values[i] + s * (swapOutputs.values[i] - previousSwapOutputs.values[i]);
+        return result;
     }
 
     void calculate(TExtFnInfo& info)
     {
+        // stepping must not allocate, in builds with CHECK_STEP_ALLOCATIONS defined we verify that
+        size_t initialAllocationCount = allocationCount();
+        timing.setSimulationTime(info.SimulationTime);
+        PhaseTimer timer(timing, Phase::calculate);
+
+        captureForFarmGroup(info);
         update(info);
         switch (controlledVar(info.lpDataName))
         {
@@ -263,126 +424,184 @@ public:
                 break;
             }
         }
-    }
-
-    double getYaw()
-    {
-        return yaw;
-    };
-
-    double getYawDot()
-    {
-        return yawDot;
-    };
 
-    int addref()
-    {
-        return refCount++;
+        if (allocationCount() != initialAllocationCount)
+            throw std::runtime_error("Heap allocation made during controller step.");
     }
 
-    int decref()
+    // the values of the controller's OrcaFlex results, see ControllerResults.hpp
+    ControllerResultValues resultValues() const
     {
-        return --refCount;
-    }
-private:
-    GUID CreateGUID()
-    {
-        GUID result;
-        if (!SUCCEEDED(CoCreateGuid(&result)))
-            throw std::runtime_error("Cannot create GUID.");
-        return result;
-    }
-
-    std::wstring GuidToString(const GUID guid)
-    {
-        wchar_t buff[37];
-        swprintf(
-            buff,
-            sizeof(buff) / sizeof(wchar_t),
-            L"%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-            guid.Data1,
-            guid.Data2,
-            guid.Data3,
-            guid.Data4[0],
-            guid.Data4[1],
-            guid.Data4[2],
-            guid.Data4[3],
-            guid.Data4[4],
-            guid.Data4[5],
-            guid.Data4[6],
-            guid.Data4[7]
-        );
-        return buff;
+        ControllerResultValues values;
+        auto set = [&values](ControllerResult result, double value) { values[static_cast<size_t>(result)] = value; };
+        set(ControllerResult::yawError, yawError);
+        set(ControllerResult::nacelleYaw, nacelleYaw);
+        set(ControllerResult::torqueDemand, swapOutputs[SwapOutput::generatorTorque]);
+        set(ControllerResult::noddingAcceleration, swapInputs[SwapInput::noddingAcceleration]);
+        set(ControllerResult::noddingAngularAcceleration, swapInputs[SwapInput::noddingAngularAcceleration]);
+        for (int bladeIndex = 0; bladeIndex < 3; bladeIndex++)
+        {
+            bool controlled = bladeIndex < controlledBladeCount;
+            set(bladeValue(ControllerResult::pitchDemand1, bladeIndex),
+                controlled ? swapOutputs[bladeValue(SwapOutput::pitchCommand1, bladeIndex)] : std::numeric_limits<double>::quiet_NaN());
+            set(bladeValue(ControllerResult::pitchRate1, bladeIndex),
+                controlled ? pitchDot[bladeIndex] : std::numeric_limits<double>::quiet_NaN());
+        }
+        return values;
     }
 
-    std::wstring Win32errToString(DWORD err)
+    // for other external functions to time their own phases as this turbine's
+    PhaseTimers& phaseTimers()
     {
-        DWORD flags = FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS | 
-            FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_ALLOCATE_BUFFER;
-        wchar_t* buffer;
-        auto len = FormatMessage(flags, nullptr, err, 0, reinterpret_cast<wchar_t*>(&buffer), 0, nullptr);
-        if (len == 0)
-            return L"";
-        std::wstring result = buffer;
-        LocalFree(reinterpret_cast<HLOCAL>(buffer));
-        return result;
+        return timing;
     }
 
-    bool convertTo8bitText(const std::wstring& input, char* output, size_t outputLen)
+    /* Values published to other external functions, which bind to them once and then read them directly. Yaw and
+       YawRate are the integrated nacelle yaw (rad) and DISCON's demanded yaw rate (rad/s), ShaftBrakeStatus is
+       record 36 and "Record n" is any avrSwap record as DISCON last returned it. */
+    const double* channel(const std::wstring& name)
     {
-        BOOL usedDefaultChar;
-        return WideCharToMultiByte(GetACP(), 0, input.c_str(), input.size(), output, outputLen, nullptr, &usedDefaultChar) && !usedDefaultChar;
+        if (name == L"Yaw")
+            return &yaw;
+        if (name == L"YawRate")
+            return &yawDot;
+        if (name == L"ShaftBrakeStatus")
+            return &swapOutputs[SwapOutput::shaftBrakeStatus];
+
+        const std::wstring recordPrefix = L"Record ";
+        double record;
+        if (name.starts_with(recordPrefix) && TryStrToDouble(utf16ToUtf8(name.substr(recordPrefix.size())), record)
+            && record >= 1 && record <= swapRecordCount && record == std::floor(record))
+            return &outputRecords[static_cast<size_t>(record) - 1];
+
+        throw std::runtime_error("Unrecognised controller channel " + utf16ToUtf8(name) +
+            ": must be Yaw, YawRate, ShaftBrakeStatus or Record n.");
     }
 
-    bool tryGetBoolFromTag(OrcaFlexObject& modelObject, const std::wstring& name, bool& value)
+    /* The state carried from one time step to the next, so that a simulation can be saved part way through and
+       resumed. DISCON's own memory is only included if the ControllerMemorySnapshot tag is True, otherwise a
+       resumed DISCON is started again with iStatus 0 at its next sample, having been given the wrapper's state as
+       it was when the simulation was saved. */
+    void storeState(TExtFnInfo& info) const
     {
-        std::wstring tagValue;
-        bool result = modelObject.tryGetTag(name, tagValue);
-        if (!result)
+        StateWriter writer(stateTag, stateVersion);
+
+        // configuration, checked on restore
+        writer.write(controlledBladeCount);
+        writer.write(useActuator);
+        writer.write(timeStep);
+        writer.write(samplePeriod);
+        writer.write(stateSpaceOrder());
+
+        writer.write(lastUpdateTime);
+        writer.write(firstCall);
+        writer.write(torque);
+        writer.write(yaw);
+        writer.write(yawDot);
+        writer.write(yawError);
+        writer.write(nacelleYaw);
+        writer.write(lastSampleTime);
+        writer.write(nextSampleTime);
+        writer.write(swapOutputs);
+        writer.write(previousSwapOutputs);
+        writer.write(avrSwap);
+        writer.write(pitch);
+        writer.write(pitchDot);
+        writer.write(pitchDotDot);
+        for (size_t index = 0; index < actuators.size(); index++)
         {
-            value = false;
-            return true;
+            ActuatorState state;
+            double input;
+            actuators.getState(index, state, input);
+            writer.write(state);
+            writer.write(input);
         }
-        if (tagValue == L"True")
+        for (const auto& actuator : stateSpaceActuators)
         {
-            value = true;
-            return true;
+            std::array<double, StateSpaceActuator::maxOrder> state;
+            double input;
+            actuator->getState(state.data(), input);
+            writer.writeBytes(state.data(), actuator->order() * sizeof(double));
+            writer.write(input);
         }
-        if (tagValue == L"False")
+
+        writer.write(libraryMemory != nullptr);
+        if (libraryMemory)
         {
-            value = false;
-            return true;
+            writer.write(disconStarted);
+            libraryMemory->save(writer);
         }
-        value = false;
-        return false;
+
+        ::storeState(info, writer);
     }
 
-    bool getBoolFromTag(OrcaFlexObject& modelObject, const std::wstring& name)
+    void restoreState(const void* data, int length)
     {
-        bool result;
-        if (!tryGetBoolFromTag(modelObject, name, result))
-            throw std::runtime_error("Unrecognised value for " + utf16ToUtf8(name) + " tag: must be False or True.");
-        return result;
+        uint32_t version;
+        StateReader reader(data, length, stateTag, version);
+        if (version < 1 || version > stateVersion)
+            throw std::runtime_error("Stored controller state has unsupported version " + std::to_string(version) + ".");
+
+        if (reader.read<int>() != controlledBladeCount || reader.read<bool>() != useActuator ||
+            reader.read<double>() != timeStep || reader.read<double>() != samplePeriod ||
+            (version >= 3 ? reader.read<size_t>() : 0) != stateSpaceOrder())
+            throw std::runtime_error("Stored controller state does not match the controller's configuration.");
+
+        reader.read(lastUpdateTime);
+        reader.read(firstCall);
+        reader.read(torque);
+        reader.read(yaw);
+        reader.read(yawDot);
+        reader.read(yawError);
+        reader.read(nacelleYaw);
+        reader.read(lastSampleTime);
+        reader.read(nextSampleTime);
+        reader.read(swapOutputs);
+        reader.read(previousSwapOutputs);
+        reader.read(avrSwap);
+        reader.read(pitch);
+        reader.read(pitchDot);
+        reader.read(pitchDotDot);
+        for (size_t index = 0; index < actuators.size(); index++)
+        {
+            ActuatorState state = reader.read<ActuatorState>();
+            actuators.setState(index, state, reader.read<double>());
+        }
+        for (const auto& actuator : stateSpaceActuators)
+        {
+            std::array<double, StateSpaceActuator::maxOrder> state;
+            reader.readBytes(state.data(), actuator->order() * sizeof(double));
+            actuator->setState(state.data(), reader.read<double>());
+        }
+
+        // memory from a DLL that is no longer snapshotted is discarded, leaving DISCON to start cold
+        if (version >= 2 && reader.read<bool>())
+        {
+            bool savedDisconStarted = reader.read<bool>();
+            if (libraryMemory)
+            {
+                libraryMemory->restore(reader);
+                disconStarted = savedDisconStarted;
+            }
+            else
+                LibraryMemory::skip(reader);
+        }
+        if (!reader.atEnd())
+            throw std::runtime_error("Stored controller state has unexpected trailing data.");
+
+        std::copy(std::begin(avrSwap), std::end(avrSwap), outputRecords.begin());
     }
 
-    double getDoubleFromTag(OrcaFlexObject& modelObject, const std::wstring& name)
+    int addref()
     {
-        std::wstring wtext;
-        if (!modelObject.tryGetTag(name, wtext))
-            throw std::runtime_error(utf16ToUtf8(name) + " tag must be defined.");
-        std::string text = utf16ToUtf8(wtext);
-        double result;
-        if (!TryStrToDouble(text, result))
-            throw std::runtime_error("Cannot convert " + utf16ToUtf8(name) + " tag of " + text + " to numeric value.");
-        return result;
+        return refCount++;
     }
 
-    float getRecord(const size_t index)
+    int decref()
     {
-        // convert between 1-based FORTRAN indexing and 0-based C++ indexing
-        return avrSwap[index - 1];
+        return --refCount;
     }
-
+private:
     void setRecord(const size_t index, const float value)
     {
         // convert between 1-based FORTRAN indexing and 0-based C++ indexing
@@ -402,6 +621,39 @@ private:
             throw std::runtime_error("Wrapper only supports OrcaFlex v11.0a and later.");
     }
 
+    void initialiseSensors()
+    {
+        // resolve all the results that are not passed in the instantaneous calculation data up front, so
+        // that they can be fetched with one call to C_GetMultipleTimeHistories per time step, and those only
+        // needed on the first call with one more then
+        generatorTorqueIndex = firstCallSensors.add(turbine, L"Generator torque");
+        windDirectionIndex = sensors.add(environment, L"Wind direction", ObjectExtra::Environment(0, 0, 0));
+        azimuthIndex = sensors.add(turbine, L"Azimuth");
+        connectionMomentLxIndex = sensors.add(turbine, L"Connection Lx moment");
+        connectionMomentLyIndex = sensors.add(turbine, L"Connection Ly moment");
+        for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
+        {
+            ObjectExtra oeBlade = ObjectExtra::Turbine(1 + bladeIndex);
+            rootMomentExIndex[bladeIndex] = sensors.add(turbine, L"Root connection Ex moment", oeBlade);
+            rootMomentEyIndex[bladeIndex] = sensors.add(turbine, L"Root connection Ey moment", oeBlade);
+            if (!commonBladeControl)
+                bladePitchIndex[bladeIndex] = sensors.add(turbine, L"Blade pitch", oeBlade);
+        }
+    }
+
+    void initialiseSwapRecords()
+    {
+        recordKernels = swapKernels(commonBladeControl, controlledBladeCount);
+
+        swapScales[SwapScale::none] = 1;
+        swapScales[SwapScale::moment] = momentScaleFactor;
+        swapScales[SwapScale::velocity] = velocityScaleFactor;
+        swapScales[SwapScale::acceleration] = accelerationScaleFactor;
+
+        // length of avcMsg character array
+        swapInputs[SwapInput::messageLength] = STRINGLENGTH;
+    }
+
     void setAccelRefPosRrtTurbine()
     {
         std::wstring posText;
@@ -422,18 +674,42 @@ private:
         }
     }
 
+    // the model's time step, or its maximum time step if variable, until the first step has been taken
     void setTimeStep()
     {
-        int status;
-        C_GetDataDouble(general.getHandle(), L"ActualOuterTimeStep", 0, &dt, &status);
-        if (status == stOK)
-            return;
+        for (const wchar_t* dataName : { L"ActualOuterTimeStep", L"ImplicitConstantTimeStep", L"ImplicitVariableMaxTimeStep" })
+        {
+            int status;
+            C_GetDataDouble(general.getHandle(), dataName, 0, &timeStep, &status);
+            if (status == stOK)
+            {
+                dt = timeStep;
+                return;
+            }
+        }
 
-        C_GetDataDouble(general.getHandle(), L"ImplicitConstantTimeStep", 0, &dt, &status);
-        if (status == stOK)
-            return;
+        throw std::runtime_error("Could not determine the simulation time step.");
+    }
 
-        throw std::runtime_error("Turbine controllers require a constant time step.");
+    void setSamplePeriod()
+    {
+        std::wstring value;
+        if (turbine.tryGetTag(L"ControllerSamplePeriod", value))
+        {
+            samplePeriod = getDoubleFromTag(turbine, L"ControllerSamplePeriod");
+            hasSamplePeriod = true;
+            if (!(samplePeriod >= timeStep))
+                throw std::runtime_error("ControllerSamplePeriod must not be less than the time step.");
+        }
+        else
+            samplePeriod = timeStep;
+
+        if (!turbine.tryGetTag(L"ControllerOutputHold", value) || value == L"ZeroOrder")
+            outputHold = OutputHold::zeroOrder;
+        else if (value == L"FirstOrder")
+            outputHold = OutputHold::firstOrder;
+        else
+            throw std::runtime_error("Unrecognised value for ControllerOutputHold tag: must be ZeroOrder or FirstOrder.");
     }
 
     void setAzimuthNorth()
@@ -459,18 +735,35 @@ private:
         throw std::runtime_error("North direction cannot be determined.");
     }
 
+    /* The ActuatorStateSpace tag, if present, gives a linear model of any order up to six in place of the second
+       order one defined by ActuatorOmega and ActuatorGamma, either as JSON or as the name of a JSON file. */
     void createActuators()
     {
+        std::wstring stateSpace;
+        if (turbine.tryGetTag(L"ActuatorStateSpace", stateSpace))
+        {
+            StateSpaceModel model = loadStateSpaceModel(stateSpace, fs::path(modelDirectory));
+            for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
+                stateSpaceActuators.push_back(createStateSpaceActuator(model, timeStep));
+            return;
+        }
+
         double omega = getDoubleFromTag(turbine, L"ActuatorOmega");
         double gamma = getDoubleFromTag(turbine, L"ActuatorGamma");
         for (int bladeIndex = 0; bladeIndex < controlledBladeCount; bladeIndex++)
-            actuators.push_back(Actuator(omega, gamma, dt));
+            actuators.add(omega, gamma);
+    }
+
+    // 0 for the second order actuators
+    size_t stateSpaceOrder() const
+    {
+        return stateSpaceActuators.empty() ? 0 : stateSpaceActuators[0]->order();
     }
 
     void initialiseTextArguments(const std::wstring modelFileName)
     {
         std::wstring value;
-        if (turbine.tryGetTag(L"InputFile", value) && !convertTo8bitText(fs::path(modelDirectory) / value, accInfile, STRINGLENGTH))
+        if (turbine.tryGetTag(L"InputFile", value) && !convertTo8bitText((fs::path(modelDirectory) / value).wstring(), accInfile, STRINGLENGTH))
             throw std::runtime_error("Could not convert input file name to 8 bit text.");
 
         /* Specify a file name that dll output can be written to. In this example, we combine the
@@ -483,46 +776,237 @@ private:
 
     void loadDll()
     {
-        std::wstring sourceDllFileName = fs::path(modelDirectory) / turbine.getTag(L"ControllerDLL");
-        if (dllCanBeShared)
-            dllFileName = sourceDllFileName;
-        else
+        fs::path sourceDllFileName = nativeLibraryFileName(fs::path(modelDirectory) / turbine.getTag(L"ControllerDLL"));
+        std::wstring hostFileName;
+        bool useHost = turbine.tryGetTag(L"ControllerHost", hostFileName);
+
+        if (snapshotMemory && (dllCanBeShared || useHost))
+            throw std::runtime_error("ControllerMemorySnapshot requires a DLL that is not shared and not run by a ControllerHost.");
+
+        // unshared DLLs need their own static data, from a private namespace where the platform has them
+        if (!dllCanBeShared && !useHost)
+            lib = loadIsolatedLibrary(sourceDllFileName);
+
+        // and otherwise from a reserved copy of the file
+        if (!lib)
         {
-            std::wstring tmp = GuidToString(CreateGUID()) + L".dll";
-            dllFileName = fs::path(fs::temp_directory_path()) / tmp;
-            fs::copy(sourceDllFileName, dllFileName);
+            fs::path dllFileName = sourceDllFileName;
+            if (!dllCanBeShared)
+            {
+                libraryCopy = std::make_unique<LibraryCopy>(sourceDllFileName);
+                dllFileName = libraryCopy->fileName();
+            }
+
+            if (useHost)
+            {
+                remoteDiscon = std::make_unique<RemoteDiscon>(fs::path(modelDirectory) / hostFileName, dllFileName, getTurbinesPerHost());
+                return;
+            }
+            lib = loadLibrary(dllFileName);
         }
-        lib = LoadLibrary(dllFileName.c_str());
         if (!lib)
         {
-            auto err = GetLastError();
-            std::wstring msg = L"Could not load DLL " + sourceDllFileName + L", error code " + std::to_wstring(err) 
-                + L", " + Win32errToString(err);
+            std::wstring msg = L"Could not load DLL " + sourceDllFileName.wstring() + L", " + lastLibraryError();
             throw std::runtime_error(utf16ToUtf8(msg));
         }
 
-        discon = reinterpret_cast<discon_func>(GetProcAddress(lib, "DISCON"));
+        discon = reinterpret_cast<discon_func>(librarySymbol(lib, "DISCON"));
         if (!discon)
         {
-            std::wstring msg = L"Could not import function named DISCON from DLL " + sourceDllFileName + L".";
+            std::wstring msg = L"Could not import function named DISCON from DLL " + sourceDllFileName.wstring() + L".";
             throw std::runtime_error(utf16ToUtf8(msg));
         }
+
+        // before any call to DISCON, so that the data is captured as loaded
+        if (snapshotMemory)
+            libraryMemory = std::make_unique<LibraryMemory>(lib);
     }
 
-    void unloadDll()
+    void joinFarmGroup(TExtFnInfo& info);
+    void leaveFarmGroup();
+    void captureForFarmGroup(TExtFnInfo& info);
+    bool farmGroupSampled(double simulationTime);
+
+    // a result that is an angle, or a rate of one, with the factor that converts it to radians
+    struct AngularSensor
+    {
+        int index = -1;
+        double toRadians = std::numeric_limits<double>::quiet_NaN();
+    };
+
+    AngularSensor addAngularSensor(const std::wstring& varName, const ObjectExtra& objectExtra = ObjectExtra())
+    {
+        std::wstring units;
+        for (const VarDetails& details : turbine.VarDetails(objectExtra))
+            if (details.varName == varName)
+                units = details.varUnits;
+        double toRadians;
+        if (units.starts_with(L"rad"))
+            toRadians = 1;
+        else if (units.starts_with(L"deg"))
+            toRadians = std::numbers::pi / 180;
+        else if (units.starts_with(L"rpm"))
+            toRadians = std::numbers::pi / 30;
+        else
+            throw std::runtime_error("Unexpected units for turbine result " + utf16ToUtf8(varName) + ".");
+        return AngularSensor{ sensors.add(turbine, varName, objectExtra), toRadians };
+    }
+
+    double angularValue(const AngularSensor& sensor) const
+    {
+        return sensor.toRadians * sensors.value(sensor.index);
+    }
+
+    /* In a farm group the inputs that OrcaFlex passes in the instantaneous calculation data are fetched as results
+       with the group's sensors instead, so that every member is sampled with the state at the group's time step
+       rather than at its own previous one. */
+    void initialiseGroupSensors()
+    {
+        ObjectExtra accelerationPosition;
+        accelerationPosition.rigidBodyPos = accelRefPosRrtTurbine;
+        groupSensors.generatorSpeed = addAngularSensor(L"Generator angular velocity");
+        groupSensors.rotorSpeed = addAngularSensor(L"Main shaft angular velocity");
+        if (commonBladeControl)
+            groupSensors.commonPitch = addAngularSensor(L"Blade pitch", ObjectExtra::Turbine(1));
+        groupSensors.rotorAzimuth = addAngularSensor(L"Rotor azimuth");
+        groupSensors.noddingAngularAcceleration = addAngularSensor(L"y angular acceleration", accelerationPosition);
+        groupSensors.hubWindSpeedIndex = sensors.add(turbine, L"Horizontal hub wind speed");
+        groupSensors.noddingAccelerationIndex = sensors.add(turbine, L"z acceleration", accelerationPosition);
+    }
+
+    TurbineInputs groupTurbineInputs() const
+    {
+        return TurbineInputs{
+            .bladeCount = latestIcd.BladeCount,
+            .generatorSpeed = angularValue(groupSensors.generatorSpeed),
+            .rotorSpeed = angularValue(groupSensors.rotorSpeed),
+            .commonPitch = commonBladeControl ? angularValue(groupSensors.commonPitch) : 0,
+            .rotorAzimuth = angularValue(groupSensors.rotorAzimuth),
+            .hubWindSpeed = sensors.value(groupSensors.hubWindSpeedIndex),
+            .noddingAcceleration = sensors.value(groupSensors.noddingAccelerationIndex),
+            .noddingAngularAcceleration = angularValue(groupSensors.noddingAngularAcceleration)
+        };
+    }
+
+    void completeGroupSample(double time)
     {
-        if (lib)
-            FreeLibrary(lib);
-        if (!dllCanBeShared && !dllFileName.empty())
+        if (groupError)
         {
-            std::error_code err;
-            fs::remove(dllFileName, err); // ignore errors
+            std::exception_ptr error = groupError;
+            groupError = nullptr;
+            std::rethrow_exception(error);
         }
+        PhaseTimer timer(timing, Phase::outputs);
+        completeSample(time);
+    }
+
+    uint32_t getTurbinesPerHost()
+    {
+        return static_cast<uint32_t>(getCountFromTag(L"ControllerHostTurbines", 8));
+    }
+
+    /* The ControllerTraceFile tag names a Chrome trace file, relative to the model, in which every traced turbine's
+       phases are recorded, with room for ControllerTraceEvents events, a million by default. */
+    void startTracing()
+    {
+        std::wstring fileName;
+        if (!turbine.tryGetTag(L"ControllerTraceFile", fileName))
+            return;
+
+        size_t eventBudget = getCountFromTag(L"ControllerTraceEvents", 1000000);
+        traceSession = TraceSession::join(fs::path(modelDirectory) / fileName, eventBudget);
+        timing.trace(traceSession.get(), traceSession->addTurbine(turbine.getName()));
+    }
+
+    /* Every DISCON call is recorded to the file named by the ControllerRecordFile tag, relative to the model, for
+       DisconReplay. A simulation resumed from stored state records from the point it resumed. */
+    void startRecording()
+    {
+        std::wstring fileName;
+        if (turbine.tryGetTag(L"ControllerRecordFile", fileName))
+            recorder = std::make_unique<SwapRecordingWriter>(fs::path(modelDirectory) / fileName, accInfile, avcOutfile);
+    }
+
+    /* avrSwap is logged to the ring file named by the ControllerLogFile tag, relative to the model. The records
+       are listed by the ControllerLogRecords tag, separated by commas or spaces, and default to those exchanged
+       with DISCON. ControllerLogRows is the ring's capacity and ControllerLogDecimation logs every n'th call. */
+    void startLogging()
+    {
+        std::wstring fileName;
+        if (!turbine.tryGetTag(L"ControllerLogFile", fileName))
+            return;
+
+        std::vector<size_t> records = swapRecordIndices(
+            commonBladeControl ? PitchControl::common : PitchControl::individual, controlledBladeCount);
+        std::wstring value;
+        if (turbine.tryGetTag(L"ControllerLogRecords", value))
+        {
+            std::replace(value.begin(), value.end(), L',', L' ');
+            std::wistringstream stream(value);
+            records.clear();
+            size_t record;
+            while (stream >> record)
+                records.push_back(record);
+            if (!stream.eof())
+                throw std::runtime_error("Cannot convert ControllerLogRecords tag of " + utf16ToUtf8(value) + " to avrSwap records.");
+        }
+        uint64_t rows = getCountFromTag(L"ControllerLogRows", 100000);
+        uint32_t decimation = static_cast<uint32_t>(getCountFromTag(L"ControllerLogDecimation", 1));
+        swapLog = std::make_unique<SwapLogWriter>(fs::path(modelDirectory) / fileName, records, rows, decimation, turbine.getName());
+    }
+
+    // a positive whole number from a tag, or the default if the tag is not defined
+    uint64_t getCountFromTag(const std::wstring& name, uint64_t defaultValue)
+    {
+        std::wstring value;
+        if (!turbine.tryGetTag(name, value))
+            return defaultValue;
+        double count = getDoubleFromTag(turbine, name);
+        if (!(count >= 1 && count <= std::numeric_limits<uint32_t>::max()) || count != std::floor(count))
+            throw std::runtime_error(utf16ToUtf8(name) + " must be a positive whole number.");
+        return static_cast<uint64_t>(count);
+    }
+
+    /* The timing summary goes to the file named by the ControllerTimingFile tag, relative to the model, if given,
+       and otherwise to the external function output window. A turbine in a farm group has its sensors fetched
+       with the group's, so that is counted in calculate but not as a phase of its own. */
+    void reportTiming()
+    {
+        if (!timing.enabled())
+            return;
+        writeDiagnostic(L"the controller timing summary", [this]
+        {
+            std::wstring summary = timing.summary(L"Controller timing for " + turbine.getName());
+            std::wstring fileName;
+            if (turbine.tryGetTag(L"ControllerTimingFile", fileName))
+            {
+                fs::path path = fs::path(modelDirectory) / fileName;
+                std::ofstream file(path, std::ios::app);
+                file << utf16ToUtf8(summary);
+                if (!file)
+                    throw std::runtime_error("Could not write " + path.string() + ".");
+            }
+            else
+                print(summary);
+        });
+    }
+
+    void unloadDll()
+    {
+        remoteDiscon.reset();
+        libraryMemory.reset();
+        freeLibrary(lib);
+        libraryCopy.reset();
     }
 
     void callDll()
     {
-        discon(avrSwap, &aviFail, accInfile, avcOutfile, avcMsg);
+        if (recorder)
+            recorder->write(swapInputs[SwapInput::time], dt, avrSwap);
+        if (remoteDiscon)
+            remoteDiscon->call(avrSwap, &aviFail, accInfile, avcOutfile, avcMsg);
+        else
+            discon(avrSwap, &aviFail, accInfile, avcOutfile, avcMsg);
     }
 private:
     OrcaFlexModel model;
@@ -535,20 +1019,36 @@ private:
     int controlledBladeCount = -1;
     bool dllCanBeShared = false;
     bool useActuator = false;
+    bool snapshotMemory = false;
     TVector accelRefPosRrtTurbine = { 0 };
     double lastUpdateTime = -std::numeric_limits<double>::infinity();
     bool firstCall = true;
+    bool disconStarted = false; // DISCON has been called with iStatus 0 since it was loaded
     double simulationStartTime = std::numeric_limits<double>::quiet_NaN();
     double momentScaleFactor = std::numeric_limits<double>::quiet_NaN();
     double velocityScaleFactor = std::numeric_limits<double>::quiet_NaN();
     double accelerationScaleFactor = std::numeric_limits<double>::quiet_NaN();
     double yaw = 0;
     double yawDot = 0;
-    double dt = std::numeric_limits<double>::quiet_NaN();
-    std::wstring dllFileName = L"";
-    HMODULE lib = 0;
+    double timeStep = std::numeric_limits<double>::quiet_NaN();
+    double dt = std::numeric_limits<double>::quiet_NaN(); // the current time step
+    bool hasSamplePeriod = false;
+    double samplePeriod = std::numeric_limits<double>::quiet_NaN();
+    OutputHold outputHold = OutputHold::zeroOrder;
+    double lastSampleTime = std::numeric_limits<double>::quiet_NaN();
+    double nextSampleTime = std::numeric_limits<double>::quiet_NaN();
+    LibraryHandle lib = nullptr;
+    std::unique_ptr<LibraryCopy> libraryCopy;
+    std::unique_ptr<LibraryMemory> libraryMemory;
     discon_func discon = nullptr;
-    float avrSwap[84] = { 0 };
+    std::unique_ptr<RemoteDiscon> remoteDiscon;
+    SwapKernels recordKernels = { nullptr, nullptr };
+    SwapInputValues swapInputs;
+    SwapOutputValues swapOutputs;
+    SwapOutputValues previousSwapOutputs;
+    SwapScales swapScales;
+    float avrSwap[swapRecordCount] = { 0 };
+    std::array<double, swapRecordCount> outputRecords = { 0 };
     int aviFail = 0;
     char accInfile[STRINGLENGTH] = { 0 };
     char avcOutfile[STRINGLENGTH] = { 0 };
@@ -557,12 +1057,347 @@ private:
     double yawError = std::numeric_limits<double>::quiet_NaN();
     double nacelleYaw = std::numeric_limits<double>::quiet_NaN();
     double azimuthNorth = std::numeric_limits<double>::quiet_NaN();
-    std::vector<Actuator> actuators;
-    std::vector<double> pitch;
-    std::vector<double> pitchDot;
-    std::vector<double> pitchDotDot;
+    TimeHistoryBatch sensors;
+    TimeHistoryBatch firstCallSensors;
+    int generatorTorqueIndex = -1; // in firstCallSensors
+    int windDirectionIndex = -1;
+    int azimuthIndex = -1;
+    int connectionMomentLxIndex = -1;
+    int connectionMomentLyIndex = -1;
+    std::array<int, 3> rootMomentExIndex = { -1, -1, -1 };
+    std::array<int, 3> rootMomentEyIndex = { -1, -1, -1 };
+    std::array<int, 3> bladePitchIndex = { -1, -1, -1 };
+    ActuatorBank actuators;
+    std::vector<std::unique_ptr<StateSpaceActuator>> stateSpaceActuators;
+    std::array<double, 3> pitch = { 0 };
+    std::array<double, 3> pitchDot = { 0 };
+    std::array<double, 3> pitchDotDot = { 0 };
+    std::shared_ptr<FarmGroup> farmGroup;
+    TTurbineInstantaneousCalculationData latestIcd = {};
+    struct
+    {
+        AngularSensor generatorSpeed;
+        AngularSensor rotorSpeed;
+        AngularSensor commonPitch;
+        AngularSensor rotorAzimuth;
+        AngularSensor noddingAngularAcceleration;
+        int hubWindSpeedIndex = -1;
+        int noddingAccelerationIndex = -1; // in turbine axes at AccelRefPosRrtTurbine
+    } groupSensors;
+    bool hasLatestIcd = false;
+    bool groupSampled = false;
+    std::exception_ptr groupError;
+    std::shared_ptr<TraceSession> traceSession; // written once every turbine tracing to it has finished
+    std::unique_ptr<ControllerCounters> counters;
+    std::unique_ptr<SwapRecordingWriter> recorder;
+    std::unique_ptr<SwapLogWriter> swapLog;
+    PhaseTimers timing;
+};
+
+/* Turbines sharing a ControllerFarmGroup tag have their DISCON calls made in parallel. The first member to
+   be calculated at a new time step fetches every member's sensors with one C_GetMultipleTimeHistories call,
+   packs the inputs of every member due to sample and calls all their DLLs on a thread pool; later members
+   just unpack the results. Only the DLL calls run off the calling thread, OrcFxAPI is never called from the
+   pool. Members cannot use the instantaneous calculation data, which other members have only from their
+   previous time step, so every input is taken from results at the current time; only the position at which
+   the wind direction is sampled is from the previous step. Each member samples itself on its first call.
+   Members must have their own copy of the DLL, as calls into a shared one would run at the same time. The
+   thread pool is shared by every group in the process. */
+class FarmGroup
+{
+public:
+    static std::shared_ptr<FarmGroup> join(Controller& controller, TOrcFxAPIHandle modelHandle, const std::wstring& name)
+    {
+        std::lock_guard<std::mutex> lock(groupsMutex);
+        std::erase_if(groups, [](const auto& item) { return item.second.expired(); });
+        auto key = std::make_pair(modelHandle, name);
+        std::shared_ptr<FarmGroup> group = groups[key].lock();
+        if (!group)
+        {
+            group = std::make_shared<FarmGroup>(sharedPool());
+            groups[key] = group;
+        }
+        group->add(controller);
+        return group;
+    }
+
+    FarmGroup(std::shared_ptr<ThreadPool> pool)
+        : pool(pool)
+    {
+    }
+
+    void leave(Controller& controller)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        members.erase(std::find(members.begin(), members.end(), &controller));
+        rebuildSensors();
+    }
+
+    void capture(Controller& controller, const TTurbineInstantaneousCalculationData& icd)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        controller.latestIcd = icd;
+        controller.hasLatestIcd = true;
+    }
+
+    // true if the group has already called the controller's DLL for this time step
+    bool sampled(Controller& controller, double simulationTime)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (simulationTime != dispatchTime)
+        {
+            dispatchTime = simulationTime;
+            dispatch(simulationTime);
+        }
+        bool result = controller.groupSampled;
+        controller.groupSampled = false;
+        return result;
+    }
+private:
+    void add(Controller& controller)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        members.push_back(&controller);
+        rebuildSensors();
+    }
+
+    void rebuildSensors()
+    {
+        sensors = TimeHistoryBatch();
+        offsets.clear();
+        for (Controller* member : members)
+            offsets.push_back(sensors.append(member->sensors));
+        due.reserve(members.size());
+    }
+
+    void dispatch(double simulationTime)
+    {
+        due.clear();
+        for (Controller* member : members)
+        {
+            member->groupSampled = false;
+            if (member->hasLatestIcd && !member->firstCall && member->sampleDue(simulationTime - member->simulationStartTime))
+            {
+                member->setSensorPosition(member->latestIcd);
+                due.push_back(member);
+            }
+        }
+        if (due.empty())
+            return;
+
+        sensors.fetch();
+        for (size_t i = 0; i < members.size(); i++)
+            members[i]->sensors.assignValues(sensors, offsets[i]);
+
+        for (Controller* member : due)
+        {
+            PhaseTimer timer(member->timing, Phase::inputs);
+            member->prepareSample(member->groupTurbineInputs(), simulationTime - member->simulationStartTime);
+        }
+
+        auto callDll = [this](size_t index)
+        {
+            Controller* member = due[index];
+            try
+            {
+                PhaseTimer timer(member->timing, Phase::discon);
+                member->callDll();
+            }
+            catch (...)
+            {
+                member->groupError = std::current_exception(); // rethrown by the member's own calculation
+            }
+        };
+        pool->run(due.size(), callDll);
+
+        for (Controller* member : due)
+            member->groupSampled = true;
+    }
+private:
+    // one pool for every group, so that groups calculated at the same time do not oversubscribe the cores,
+    // called with groupsMutex held
+    static std::shared_ptr<ThreadPool> sharedPool()
+    {
+        std::shared_ptr<ThreadPool> result = groupPool.lock();
+        if (!result)
+        {
+            result = std::make_shared<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()) - 1);
+            groupPool = result;
+        }
+        return result;
+    }
+
+    static std::mutex groupsMutex;
+    static std::map<std::pair<TOrcFxAPIHandle, std::wstring>, std::weak_ptr<FarmGroup>> groups;
+    static std::weak_ptr<ThreadPool> groupPool;
+
+    std::mutex mutex;
+    std::vector<Controller*> members;
+    std::vector<Controller*> due;
+    std::vector<int> offsets;
+    TimeHistoryBatch sensors;
+    double dispatchTime = std::numeric_limits<double>::quiet_NaN();
+    std::shared_ptr<ThreadPool> pool;
+};
+
+std::mutex FarmGroup::groupsMutex;
+std::map<std::pair<TOrcFxAPIHandle, std::wstring>, std::weak_ptr<FarmGroup>> FarmGroup::groups;
+std::weak_ptr<ThreadPool> FarmGroup::groupPool;
+
+void Controller::joinFarmGroup(TExtFnInfo& info)
+{
+    std::wstring name;
+    if (!turbine.tryGetTag(L"ControllerFarmGroup", name))
+        return;
+    if (dllCanBeShared)
+        throw std::runtime_error("ControllerFarmGroup requires a DLL that is not shared: ControllerDLLCanBeShared must be False.");
+    initialiseGroupSensors();
+    farmGroup = FarmGroup::join(*this, info.ModelHandle, name);
+}
+
+void Controller::leaveFarmGroup()
+{
+    if (farmGroup)
+        farmGroup->leave(*this);
+    farmGroup.reset();
+}
+
+void Controller::captureForFarmGroup(TExtFnInfo& info)
+{
+    if (farmGroup)
+        farmGroup->capture(*this, *static_cast<const TTurbineInstantaneousCalculationData*>(info.lpInstantaneousCalculationData));
+}
+
+bool Controller::farmGroupSampled(double simulationTime)
+{
+    return farmGroup && farmGroup->sampled(*this, simulationTime);
+}
+
+/* Returns a reference to the turbine's controller, held by the turbine as the named value keyName so that its
+   pitch and torque external functions share one, creating it if this is the first. Errors are recorded against
+   the external function and nullptr returned. */
+template<typename T>
+static T* acquireController(TExtFnInfo& info, const wchar_t* keyName)
+{
+    int status;
+    INT_PTR controllerPtr = C_GetNamedValue(info.ObjectHandle, keyName, &status);
+    if (!checkStatus(info, L"Call to C_GetNamedValue from eaInitialise", status))
+        return nullptr;
+
+    T *controller;
+    if (controllerPtr)
+        controller = reinterpret_cast<T*>(controllerPtr);
+    else
+    {
+        std::unique_ptr<T> newController;
+        try
+        {
+            newController = std::make_unique<T>(info);
+        }
+        catch(const std::exception& exc)
+        {
+            int status;
+            std::wstring error = OrcaFlexObject(info.ObjectHandle).getName() + L"\n\n" +
+                utf8ToUtf16(std::string("Could not initialise controller. ") + exc.what());
+            C_RecordExternalFunctionError(&info, error.c_str(), &status); // ignore status
+            return nullptr;
+        }
+
+        controllerPtr = reinterpret_cast<INT_PTR>(newController.get());
+        C_SetNamedValue(info.ObjectHandle, keyName, controllerPtr, &status);
+        if (!checkStatus(info, L"Call to C_SetNamedValue from eaInitialise", status))
+            return nullptr; // newController destroys the controller as we unwind
+        controller = newController.release();
+    }
+    controller->addref();
+    return controller;
+}
+
+// drops a reference to a turbine's controller, destroying it along with the last reference
+template<typename T>
+static bool releaseController(TExtFnInfo& info, T* controller, TOrcFxAPIHandle turbineHandle, const wchar_t* keyName)
+{
+    if (controller->decref() != 0)
+        return true;
+
+    std::unique_ptr<T> owned(controller); // delete on scope exit regardless of C_SetNamedValue outcome
+    int status;
+    C_SetNamedValue(turbineHandle, keyName, 0, &status);
+    return checkStatus(info, L"Call to C_SetNamedValue from eaFinalise", status);
+}
+
+static void allowResume(TExtFnInfo& info)
+{
+    // CanResumeSimulation is absent from the structure passed by older versions of OrcaFlex
+    if (info.Size >= static_cast<int>(offsetof(TExtFnInfo, CanResumeSimulation) + sizeof(BOOL)))
+        info.CanResumeSimulation = TRUE;
+}
+
+/* Another external function's hold on the channels of a turbine's controller. The controller is looked up once
+   and referenced, so the channels stay valid until release whichever of the turbine and the consumer is
+   finalised first. Binding is attempted at eaInitialise and, if the turbine's controller has not been created
+   by then, at the first eaCalculate. */
+class ControllerBinding
+{
+public:
+    ControllerBinding(TOrcFxAPIHandle turbineHandle, std::vector<std::wstring> channelNames)
+        : turbineHandle(turbineHandle), channelNames(std::move(channelNames)), channels(this->channelNames.size(), nullptr)
+    {
+    }
+
+    bool bound() const
+    {
+        return controller != nullptr;
+    }
+
+    // false if the turbine has no controller yet
+    bool tryBind()
+    {
+        int status;
+        INT_PTR controllerPtr = C_GetNamedValue(turbineHandle, controllerKeyName, &status);
+        checkStatus(status);
+        if (!controllerPtr)
+            return false;
+
+        Controller* candidate = reinterpret_cast<Controller*>(controllerPtr);
+        for (size_t i = 0; i < channelNames.size(); i++)
+            channels[i] = candidate->channel(channelNames[i]);
+        controller = candidate;
+        controller->addref();
+        return true;
+    }
+
+    double value(size_t index) const
+    {
+        return *channels[index];
+    }
+
+    PhaseTimers& timers() const
+    {
+        return controller->phaseTimers();
+    }
+
+    bool release(TExtFnInfo& info)
+    {
+        if (!controller)
+            return true;
+        Controller* released = controller;
+        controller = nullptr;
+        return releaseController(info, released, turbineHandle, controllerKeyName);
+    }
+private:
+    TOrcFxAPIHandle turbineHandle;
+    std::vector<std::wstring> channelNames;
+    std::vector<const double*> channels;
+    Controller* controller = nullptr;
 };
 
+static void bindController(ControllerBinding& binding)
+{
+    if (!binding.bound() && !binding.tryBind())
+        throw std::runtime_error("the turbine's controller was not found. Ensure controllers are active for the associated turbine object.");
+}
+
 extern "C"
 {
 
@@ -574,51 +1409,51 @@ void __stdcall BladedController(TExtFnInfo& info)
         {
         case eaInitialise:
         {
-            int status;
-            INT_PTR controllerPtr = C_GetNamedValue(info.ObjectHandle, controllerKeyName, &status);
-            if (!checkStatus(info, L"Call to C_GetNamedValue from eaInitialise", status))
+            Controller *controller = acquireController<Controller>(info, controllerKeyName);
+            if (!controller)
                 return;
-
-            Controller *controller;
-            if (controllerPtr)
-                controller = reinterpret_cast<Controller*>(controllerPtr);
-            else
-            {
-                std::unique_ptr<Controller> newController;
-                try
-                {
-                    newController = std::make_unique<Controller>(info);
-                }
-                catch(const std::exception& exc)
-                {
-                    int status;
-                    std::wstring error = OrcaFlexObject(info.ObjectHandle).getName() + L"\n\n" +
-                        utf8ToUtf16(std::string("Could not initialise controller. ") + exc.what());
-                    C_RecordExternalFunctionError(&info, error.c_str(), &status); // ignore status
-                    return;
-                }
-
-                controllerPtr = reinterpret_cast<INT_PTR>(newController.get());
-                C_SetNamedValue(info.ObjectHandle, controllerKeyName, controllerPtr, &status);
-                if (!checkStatus(info, L"Call to C_SetNamedValue from eaInitialise", status))
-                    return; // newController destroys the controller as we unwind
-                controller = newController.release();
-            }
-            controller->addref();
             info.lpData = static_cast<void*>(controller);
+            allowResume(info);
             break;
         }
         case eaFinalise:
         {
             Controller *controller = static_cast<Controller*>(info.lpData);
-            if (controller->decref() == 0)
-            {
-                std::unique_ptr<Controller> owned(controller); // delete on scope exit regardless of C_SetNamedValue outcome
-                int status;
-                C_SetNamedValue(info.ObjectHandle, controllerKeyName, 0, &status);
-                if (!checkStatus(info, L"Call to C_SetNamedValue from eaFinalise", status))
-                    return;
-            }
+            if (!releaseController(info, controller, info.ObjectHandle, controllerKeyName))
+                return;
+            break;
+        }
+        case eaStoreStateCreate:
+        {
+            // both the pitch and torque external functions store the turbine's state, either can restore it
+            Controller *controller = static_cast<Controller*>(info.lpData);
+            controller->storeState(info);
+            break;
+        }
+        case eaStoreStateDestroy:
+        {
+            destroyState(info);
+            break;
+        }
+        case eaRegisterResults:
+        {
+            registerControllerResults(info);
+            break;
+        }
+        case eaLogResultCreate:
+        {
+            Controller *controller = static_cast<Controller*>(info.lpData);
+            logControllerResults(info, controller->resultValues());
+            break;
+        }
+        case eaLogResultDestroy:
+        {
+            destroyLoggedResults(info);
+            break;
+        }
+        case eaDeriveResult:
+        {
+            deriveControllerResult(info);
             break;
         }
         case eaCalculate:
@@ -647,6 +1482,72 @@ void __stdcall BladedController(TExtFnInfo& info)
     }
 }
 
+// the NREL 5MW baseline controller, a native equivalent of the PythonController example
+void __stdcall NREL5MWController(TExtFnInfo& info)
+{
+    try
+    {
+        switch(info.Action)
+        {
+        case eaInitialise:
+        {
+            BaselineController *controller = acquireController<BaselineController>(info, baselineControllerKeyName);
+            if (!controller)
+                return;
+            info.lpData = static_cast<void*>(controller);
+            allowResume(info);
+            break;
+        }
+        case eaFinalise:
+        {
+            BaselineController *controller = static_cast<BaselineController*>(info.lpData);
+            if (controller && !releaseController(info, controller, info.ObjectHandle, baselineControllerKeyName))
+                return;
+            break;
+        }
+        case eaStoreStateCreate:
+        {
+            BaselineController *controller = static_cast<BaselineController*>(info.lpData);
+            controller->storeState(info);
+            break;
+        }
+        case eaStoreStateDestroy:
+        {
+            destroyState(info);
+            break;
+        }
+        case eaCalculate:
+        {
+            BaselineController *controller = static_cast<BaselineController*>(info.lpData);
+            controller->update(info);
+            switch (controlledVar(info.lpDataName))
+            {
+                case ControlledVar::torque:
+                {
+                    info.Value = controller->getTorque();
+                    break;
+                }
+                case ControlledVar::pitch:
+                {
+                    TScalarStructValue *sv = static_cast<TScalarStructValue*>(info.lpStructValue);
+                    sv->Value = controller->getPitch();
+                    sv->Velocity = controller->getPitchDot();
+                    sv->Acceleration = controller->getPitchDotDot();
+                    break;
+                }
+            }
+            break;
+        }
+        }
+    }
+    catch(const std::exception& exc)
+    {
+        int status;
+        std::wstring error = OrcaFlexObject(info.ObjectHandle).getName() + L"\n\n" + utf8ToUtf16(exc.what());
+        C_RecordExternalFunctionError(&info, error.c_str(), &status); // ignore status
+    }
+}
+
 void __stdcall YawController(TExtFnInfo& info)
 {
     try
@@ -674,26 +1575,26 @@ void __stdcall YawController(TExtFnInfo& info)
             if (!checkStatus(info, msg, status))
                 return;
 
-            info.lpData = static_cast<void*>(objectInfo.ObjectHandle);
+            auto binding = std::make_unique<ControllerBinding>(objectInfo.ObjectHandle, std::vector<std::wstring>{ L"Yaw", L"YawRate" });
+            binding->tryBind();
+            info.lpData = static_cast<void*>(binding.release());
             break;
         }
-        case eaCalculate:
+        case eaFinalise:
         {
-            int status;
-
-            TOrcFxAPIHandle turbineHandle = static_cast<TOrcFxAPIHandle>(info.lpData);
-            INT_PTR controllerPtr = C_GetNamedValue(turbineHandle, controllerKeyName, &status);
-            if (!checkStatus(info, L"Call to C_GetNamedValue from eaCalculate", status))
+            std::unique_ptr<ControllerBinding> binding(static_cast<ControllerBinding*>(info.lpData));
+            if (binding && !binding->release(info))
                 return;
+            break;
+        }
+        case eaCalculate:
+        {
+            ControllerBinding* binding = static_cast<ControllerBinding*>(info.lpData);
+            bindController(*binding);
+            PhaseTimer timer(binding->timers(), Phase::yaw);
 
-            Controller *controller;
-            if (controllerPtr)
-                controller = reinterpret_cast<Controller*>(controllerPtr);
-            else
-                throw std::runtime_error("the turbine's controller was not found. Ensure controllers are active for the associated turbine object.");
-
-            double yaw = controller->getYaw();
-            double yawDot = controller->getYawDot();
+            double yaw = binding->value(0);
+            double yawDot = binding->value(1);
 
             double c = cos(yaw);
             double s = sin(yaw);
@@ -719,4 +1620,61 @@ void __stdcall YawController(TExtFnInfo& info)
     }
 }
 
+/* Returns one controller channel as the value of any externally calculated data item, e.g. a winch or link,
+   so that further actuators can be driven by the same DISCON. The object needs TurbineName and
+   ControllerChannel tags, see Controller::channel for the channel names. */
+void __stdcall ControllerOutput(TExtFnInfo& info)
+{
+    try
+    {
+        switch(info.Action)
+        {
+        case eaInitialise:
+        {
+            int status;
+            OrcaFlexObject modelObject(info.ObjectHandle);
+            std::wstring objectName = modelObject.GetDataString(L"Name");
+            std::wstring turbineName, channelName;
+            if (!modelObject.tryGetTag(L"TurbineName", turbineName) || !modelObject.tryGetTag(L"ControllerChannel", channelName))
+                throw std::runtime_error(
+                  "to use '" + utf16ToUtf8(objectName) + "' to output a controller channel, it must have object tags named "
+                  "'TurbineName', containing the associated turbine object name, and 'ControllerChannel'."
+                );
+
+            TObjectInfo objectInfo;
+            C_ObjectCalled(info.ModelHandle, turbineName.c_str(), &objectInfo, &status);
+            std::wstring msg = L"The turbine '" + turbineName + L"' named by the 'TurbineName' object tag for '" + objectName +
+                               L"' cannot be found in the model, ";
+            if (!checkStatus(info, msg, status))
+                return;
+
+            auto binding = std::make_unique<ControllerBinding>(objectInfo.ObjectHandle, std::vector<std::wstring>{ channelName });
+            binding->tryBind();
+            info.lpData = static_cast<void*>(binding.release());
+            break;
+        }
+        case eaFinalise:
+        {
+            std::unique_ptr<ControllerBinding> binding(static_cast<ControllerBinding*>(info.lpData));
+            if (binding && !binding->release(info))
+                return;
+            break;
+        }
+        case eaCalculate:
+        {
+            ControllerBinding* binding = static_cast<ControllerBinding*>(info.lpData);
+            bindController(*binding);
+            info.Value = binding->value(0);
+            break;
+        }
+        }
+    }
+    catch(const std::exception& exc)
+    {
+        int status;
+        std::wstring msg = L"Unexpected error, " + utf8ToUtf16(exc.what());
+        C_RecordExternalFunctionError(&info, msg.c_str(), &status); // ignore status
+    }
+}
+
 }
\ No newline at end of file
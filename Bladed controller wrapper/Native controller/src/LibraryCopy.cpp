@@ -0,0 +1,87 @@
+#include "LibraryCopy.hpp"
+#include "Platform.hpp"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// instance numbers in use by this process, per library key
+static std::mutex instancesMutex;
+static std::map<std::string, std::vector<bool>> instancesInUse;
+
+static uint64_t contentHash(const fs::path& fileName)
+{
+    // 64-bit FNV-1a, only used to tell library versions apart
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Could not read DLL " + utf16ToUtf8(fileName.wstring()) + ".");
+    uint64_t hash = 14695981039346656037ull;
+    std::vector<char> buffer(1 << 16);
+    while (file)
+    {
+        file.read(buffer.data(), buffer.size());
+        for (std::streamsize i = 0; i < file.gcount(); i++)
+            hash = (hash ^ static_cast<unsigned char>(buffer[i])) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint32_t reserveInstance(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(instancesMutex);
+    std::vector<bool>& inUse = instancesInUse[key];
+    uint32_t instance = 0;
+    while (instance < inUse.size() && inUse[instance])
+        instance++;
+    if (instance == inUse.size())
+        inUse.push_back(true);
+    else
+        inUse[instance] = true;
+    return instance;
+}
+
+LibraryCopy::LibraryCopy(const fs::path& sourceFileName)
+{
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(contentHash(sourceFileName)));
+    key = utf16ToUtf8(sourceFileName.stem().wstring()) + "-" + hash;
+    instance = reserveInstance(key);
+
+    try
+    {
+        fs::path folder = fs::temp_directory_path() / L"BladedControllerWrapper";
+        fs::create_directories(folder);
+        copyFileName = folder / (utf8ToUtf16(key + "-" + std::to_string(instance)) + sourceFileName.extension().wstring());
+        if (fs::exists(copyFileName))
+            return;
+
+        // copy under a unique name and rename into place, so that other processes never see a partial copy
+        fs::path partialFileName = folder / (createUniqueName() + L".partial");
+        fs::copy_file(sourceFileName, partialFileName);
+        std::error_code err;
+        fs::rename(partialFileName, copyFileName, err);
+        if (err)
+        {
+            // another process got there first, and may already have the copy loaded
+            fs::remove(partialFileName, err);
+            if (!fs::exists(copyFileName))
+                throw std::runtime_error("Could not copy DLL " + utf16ToUtf8(sourceFileName.wstring()) + ".");
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(instancesMutex);
+        instancesInUse[key][instance] = false;
+        throw;
+    }
+}
+
+LibraryCopy::~LibraryCopy()
+{
+    std::lock_guard<std::mutex> lock(instancesMutex);
+    instancesInUse[key][instance] = false;
+}
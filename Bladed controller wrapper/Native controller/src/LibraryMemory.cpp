@@ -0,0 +1,118 @@
+#include "LibraryMemory.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <windows.h> // for __cdecl, from include/posix on Linux
+
+typedef size_t (__cdecl *save_memory_func)(void*, size_t);
+typedef int (__cdecl *restore_memory_func)(const void*, size_t);
+
+LibraryMemory::LibraryMemory(LibraryHandle lib)
+{
+    if (!libraryWritableData(lib, image, data))
+        throw std::runtime_error("Could not locate the static data of the controller DLL.");
+
+    for (const MemoryRange& range : data)
+        pristine.insert(pristine.end(), range.address, range.address + range.size);
+
+    saveMemory = librarySymbol(lib, "DISCON_SaveMemory");
+    restoreMemory = librarySymbol(lib, "DISCON_RestoreMemory");
+}
+
+void LibraryMemory::save(StateWriter& writer) const
+{
+    writer.write(reinterpret_cast<uint64_t>(image.address));
+    writer.write(static_cast<uint64_t>(image.size));
+    writer.write(static_cast<uint32_t>(data.size()));
+    const char* pristineRange = pristine.data();
+    for (const MemoryRange& range : data)
+    {
+        writer.write(static_cast<uint64_t>(range.address - image.address));
+        writer.write(static_cast<uint64_t>(range.size));
+        writer.writeBytes(pristineRange, range.size);
+        writer.writeBytes(range.address, range.size);
+        pristineRange += range.size;
+    }
+
+    std::vector<char> heap;
+    if (saveMemory)
+    {
+        auto save = reinterpret_cast<save_memory_func>(saveMemory);
+        heap.resize(save(nullptr, 0));
+        if (save(heap.data(), heap.size()) != heap.size())
+            throw std::runtime_error("DISCON_SaveMemory returned an inconsistent size.");
+    }
+    writer.write(static_cast<uint64_t>(heap.size()));
+    writer.writeBytes(heap.data(), heap.size());
+}
+
+void LibraryMemory::restore(StateReader& reader)
+{
+    uint64_t savedImageAddress = reader.read<uint64_t>();
+    uint64_t savedImageSize = reader.read<uint64_t>();
+    if (savedImageSize != image.size || reader.read<uint32_t>() != data.size())
+        throw std::runtime_error("Stored controller memory does not match the controller DLL.");
+
+    const uintptr_t oldBegin = static_cast<uintptr_t>(savedImageAddress);
+    const uintptr_t oldEnd = oldBegin + static_cast<uintptr_t>(savedImageSize);
+    const uintptr_t delta = reinterpret_cast<uintptr_t>(image.address) - oldBegin;
+    for (const MemoryRange& range : data)
+    {
+        if (reader.read<uint64_t>() != static_cast<uint64_t>(range.address - image.address) || reader.read<uint64_t>() != range.size)
+            throw std::runtime_error("Stored controller memory does not match the controller DLL.");
+        const char* savedPristine = reader.readBytes(range.size);
+        const char* saved = reader.readBytes(range.size);
+
+        // bytes before the first aligned word and after the last are compared individually
+        size_t begin = (sizeof(uintptr_t) - reinterpret_cast<uintptr_t>(range.address) % sizeof(uintptr_t)) % sizeof(uintptr_t);
+        begin = std::min(begin, range.size);
+        size_t end = begin + (range.size - begin) / sizeof(uintptr_t) * sizeof(uintptr_t);
+        for (size_t i = 0; i < range.size;)
+        {
+            if (i >= begin && i < end)
+            {
+                uintptr_t value, valueAtLoad;
+                memcpy(&value, saved + i, sizeof(value));
+                memcpy(&valueAtLoad, savedPristine + i, sizeof(valueAtLoad));
+                if (value != valueAtLoad)
+                {
+                    if (value >= oldBegin && value < oldEnd)
+                        value += delta;
+                    memcpy(range.address + i, &value, sizeof(value));
+                }
+                i += sizeof(uintptr_t);
+            }
+            else
+            {
+                if (saved[i] != savedPristine[i])
+                    range.address[i] = saved[i];
+                i++;
+            }
+        }
+    }
+
+    uint64_t heapSize = reader.read<uint64_t>();
+    const char* heap = reader.readBytes(static_cast<size_t>(heapSize));
+    if (heapSize == 0)
+        return;
+    if (!restoreMemory)
+        throw std::runtime_error("Stored controller memory includes heap data but the DLL does not export DISCON_RestoreMemory.");
+    if (reinterpret_cast<restore_memory_func>(restoreMemory)(heap, static_cast<size_t>(heapSize)) != 0)
+        throw std::runtime_error("DISCON_RestoreMemory failed.");
+}
+
+void LibraryMemory::skip(StateReader& reader)
+{
+    reader.read<uint64_t>();
+    reader.read<uint64_t>();
+    uint32_t rangeCount = reader.read<uint32_t>();
+    for (uint32_t i = 0; i < rangeCount; i++)
+    {
+        reader.read<uint64_t>();
+        uint64_t size = reader.read<uint64_t>();
+        reader.readBytes(static_cast<size_t>(size));
+        reader.readBytes(static_cast<size_t>(size));
+    }
+    reader.readBytes(static_cast<size_t>(reader.read<uint64_t>()));
+}
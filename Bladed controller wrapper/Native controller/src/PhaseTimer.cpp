@@ -0,0 +1,107 @@
+#include "PhaseTimer.hpp"
+#include "ControllerCounters.hpp"
+#include "TraceRecorder.hpp"
+#include <bit>
+#include <cwchar>
+
+size_t TimingHistogram::bucket(uint64_t ticks)
+{
+    if (ticks < 4)
+        return static_cast<size_t>(ticks);
+    // the power of two and the next two bits below the leading one
+    int exponent = std::bit_width(ticks) - 1;
+    size_t fraction = static_cast<size_t>(ticks >> (exponent - 2)) & 3;
+    return 4 * static_cast<size_t>(exponent - 1) + fraction;
+}
+
+uint64_t TimingHistogram::bucketUpperBound(size_t index)
+{
+    if (index < 4)
+        return index;
+    int exponent = static_cast<int>(index / 4) + 1;
+    uint64_t fraction = index % 4;
+    uint64_t lower = (4 + fraction) << (exponent - 2);
+    return lower + ((uint64_t(1) << (exponent - 2)) - 1);
+}
+
+uint64_t TimingHistogram::quantile(double fraction) const
+{
+    uint64_t target = static_cast<uint64_t>(fraction * count);
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < buckets.size(); i++)
+    {
+        cumulative += buckets[i];
+        if (cumulative > target)
+            return std::min(bucketUpperBound(i), max);
+    }
+    return max;
+}
+
+const wchar_t* phaseName(Phase phase)
+{
+    static const wchar_t* const names[phaseCount] = {
+        L"calculate", L"sensors", L"inputs", L"discon", L"outputs", L"actuator", L"yaw"
+    };
+    return names[static_cast<size_t>(phase)];
+}
+
+void PhaseTimers::enable()
+{
+    on = true;
+    startTime = std::chrono::steady_clock::now();
+    startTicks = timestamp();
+}
+
+void PhaseTimers::trace(TraceSession* session, uint32_t turbine)
+{
+    traceSession = session;
+    traceTurbine = turbine;
+}
+
+void PhaseTimers::traceEvent(Phase phase, uint64_t ticks, bool begin)
+{
+    traceSession->record(ticks, simulationTime, traceTurbine, phase, begin);
+}
+
+void PhaseTimers::count(ControllerCounters* counters)
+{
+    this->counters = counters;
+}
+
+void PhaseTimers::countEvent(Phase phase, uint64_t ticks)
+{
+    counters->add(phase, ticks);
+}
+
+std::wstring PhaseTimers::summary(const std::wstring& title) const
+{
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t ticks = timestamp() - startTicks;
+    double microsecondsPerTick = ticks > 0 ? 1e6 * seconds / ticks : 0;
+
+    const TimingHistogram& calculate = histograms[static_cast<size_t>(Phase::calculate)];
+    wchar_t line[256];
+    swprintf(line, sizeof(line) / sizeof(wchar_t), L"%ls: %llu time steps, %llu calculate calls (%.2f per step)\n",
+        title.c_str(), static_cast<unsigned long long>(timeSteps), static_cast<unsigned long long>(calculate.calls()),
+        timeSteps > 0 ? static_cast<double>(calculate.calls()) / timeSteps : 0.0);
+    std::wstring result = line;
+    swprintf(line, sizeof(line) / sizeof(wchar_t), L"%-10ls %12ls %10ls %10ls %10ls %10ls %10ls\n",
+        L"phase", L"calls", L"mean us", L"p50 us", L"p99 us", L"max us", L"total s");
+    result += line;
+    for (size_t i = 0; i < phaseCount; i++)
+    {
+        const TimingHistogram& histogram = histograms[i];
+        if (histogram.calls() == 0)
+            continue;
+        swprintf(line, sizeof(line) / sizeof(wchar_t), L"%-10ls %12llu %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+            phaseName(static_cast<Phase>(i)),
+            static_cast<unsigned long long>(histogram.calls()),
+            microsecondsPerTick * histogram.totalTicks() / histogram.calls(),
+            microsecondsPerTick * histogram.quantile(0.5),
+            microsecondsPerTick * histogram.quantile(0.99),
+            microsecondsPerTick * histogram.maxTicks(),
+            1e-6 * microsecondsPerTick * histogram.totalTicks());
+        result += line;
+    }
+    return result;
+}
@@ -0,0 +1,448 @@
+#include "Platform.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <random>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+
+fs::path nativeLibraryFileName(const fs::path& fileName)
+{
+    return fileName;
+}
+
+LibraryHandle loadLibrary(const fs::path& fileName)
+{
+    return LoadLibraryW(fileName.c_str());
+}
+
+LibraryHandle loadIsolatedLibrary(const fs::path&)
+{
+    return nullptr; // the loader maps a file only once per process
+}
+
+void* librarySymbol(LibraryHandle lib, const char* name)
+{
+    return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(lib), name));
+}
+
+void freeLibrary(LibraryHandle lib)
+{
+    if (lib)
+        FreeLibrary(static_cast<HMODULE>(lib));
+}
+
+bool libraryWritableData(LibraryHandle lib, MemoryRange& image, std::vector<MemoryRange>& data)
+{
+    if (!lib)
+        return false;
+
+    // the module handle is the image base, the writable sections are listed in its PE headers
+    char* base = static_cast<char*>(lib);
+    const IMAGE_DOS_HEADER* dosHeader = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+    const IMAGE_NT_HEADERS* ntHeaders = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + dosHeader->e_lfanew);
+    image = { base, ntHeaders->OptionalHeader.SizeOfImage };
+
+    data.clear();
+    const IMAGE_SECTION_HEADER* section = IMAGE_FIRST_SECTION(ntHeaders);
+    for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; i++, section++)
+        if ((section->Characteristics & IMAGE_SCN_MEM_WRITE) && section->Misc.VirtualSize > 0)
+            data.push_back({ base + section->VirtualAddress, section->Misc.VirtualSize });
+    return true;
+}
+
+MappedFile::MappedFile(const fs::path& fileName, size_t size)
+    : length(size)
+{
+    HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Could not create " + fileName.string() + ".");
+    ULARGE_INTEGER mappingSize;
+    mappingSize.QuadPart = size;
+    handle = CreateFileMappingW(file, nullptr, PAGE_READWRITE, mappingSize.HighPart, mappingSize.LowPart, nullptr);
+    CloseHandle(file); // the mapping keeps the file open
+    if (!handle)
+        throw std::runtime_error("Could not size " + fileName.string() + ".");
+    address = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!address)
+    {
+        CloseHandle(handle);
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    }
+}
+
+MappedFile::MappedFile(const fs::path& fileName)
+{
+    HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Could not open " + fileName.string() + ".");
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    handle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!handle)
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    address = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    if (!address)
+    {
+        CloseHandle(handle);
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(address);
+    CloseHandle(handle);
+}
+
+static std::wstring Win32errToString(DWORD err)
+{
+    DWORD flags = FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS |
+        FORMAT_MESSAGE_ARGUMENT_ARRAY | FORMAT_MESSAGE_ALLOCATE_BUFFER;
+    wchar_t* buffer;
+    auto len = FormatMessageW(flags, nullptr, err, 0, reinterpret_cast<wchar_t*>(&buffer), 0, nullptr);
+    if (len == 0)
+        return L"";
+    std::wstring result = buffer;
+    LocalFree(reinterpret_cast<HLOCAL>(buffer));
+    return result;
+}
+
+std::wstring lastLibraryError()
+{
+    auto err = GetLastError();
+    return L"error code " + std::to_wstring(err) + L", " + Win32errToString(err);
+}
+
+std::wstring createUniqueName()
+{
+    GUID guid;
+    if (!SUCCEEDED(CoCreateGuid(&guid)))
+        throw std::runtime_error("Cannot create GUID.");
+
+    wchar_t buff[37];
+    swprintf(
+        buff,
+        sizeof(buff) / sizeof(wchar_t),
+        L"%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+        guid.Data1,
+        guid.Data2,
+        guid.Data3,
+        guid.Data4[0],
+        guid.Data4[1],
+        guid.Data4[2],
+        guid.Data4[3],
+        guid.Data4[4],
+        guid.Data4[5],
+        guid.Data4[6],
+        guid.Data4[7]
+    );
+    return buff;
+}
+
+std::string utf16ToUtf8(const std::wstring& value)
+{
+    std::string result;
+    int retval = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), value.size(), nullptr, 0, nullptr, nullptr);
+    result.resize(retval);
+    retval = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), value.size(), result.data(), retval, nullptr, nullptr);
+    if (value.size() > 0 && retval == 0)
+        throw std::runtime_error("Conversion failure: utf16 to utf8.");
+    return result;
+}
+
+std::wstring utf8ToUtf16(const std::string value)
+{
+    std::wstring result;
+    int retval = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), value.size(), nullptr, 0);
+    result.resize(retval);
+    retval = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), value.size(), result.data(), retval);
+    if (value.size() > 0 && retval == 0)
+        throw std::runtime_error("Conversion failure: utf8 to utf16.");
+    return result;
+}
+
+bool convertTo8bitText(const std::wstring& input, char* output, size_t outputLen)
+{
+    BOOL usedDefaultChar;
+    return WideCharToMultiByte(GetACP(), 0, input.c_str(), input.size(), output, outputLen, nullptr, &usedDefaultChar) && !usedDefaultChar;
+}
+
+#else
+
+fs::path nativeLibraryFileName(const fs::path& fileName)
+{
+    std::wstring extension = fileName.extension().wstring();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::towlower);
+    if (extension != L".dll")
+        return fileName;
+    return fileName.parent_path() / (L"lib" + fileName.stem().wstring() + libraryExtension);
+}
+
+LibraryHandle loadLibrary(const fs::path& fileName)
+{
+    // RTLD_LOCAL so that controllers exporting the same symbols do not bind to each other
+    return dlopen(fileName.c_str(), RTLD_NOW | RTLD_LOCAL);
+}
+
+LibraryHandle loadIsolatedLibrary(const fs::path& fileName)
+{
+#ifdef LM_ID_NEWLM
+    // a new link map namespace, glibc allows around 15 of them so callers need a fallback
+    return dlmopen(LM_ID_NEWLM, fileName.c_str(), RTLD_NOW | RTLD_LOCAL);
+#else
+    return nullptr;
+#endif
+}
+
+void* librarySymbol(LibraryHandle lib, const char* name)
+{
+    return dlsym(lib, name);
+}
+
+void freeLibrary(LibraryHandle lib)
+{
+    if (lib)
+        dlclose(lib);
+}
+
+static void appendRange(std::vector<MemoryRange>& ranges, char* begin, char* end)
+{
+    if (end > begin)
+        ranges.push_back({ begin, static_cast<size_t>(end - begin) });
+}
+
+bool libraryWritableData(LibraryHandle lib, MemoryRange& image, std::vector<MemoryRange>& data)
+{
+    link_map* map;
+    if (!lib || dlinfo(lib, RTLD_DI_LINKMAP, &map) != 0)
+        return false;
+
+    /* dl_iterate_phdr only reports the caller's link map namespace, so the program headers are read from the ELF
+       header, which shared objects map at the load address */
+    char* base = reinterpret_cast<char*>(map->l_addr);
+    const ElfW(Ehdr)* elfHeader = reinterpret_cast<const ElfW(Ehdr)*>(base);
+    if (!base || memcmp(elfHeader->e_ident, ELFMAG, SELFMAG) != 0)
+        return false;
+    const ElfW(Phdr)* headers = reinterpret_cast<const ElfW(Phdr)*>(base + elfHeader->e_phoff);
+
+    char* imageBegin = nullptr;
+    char* imageEnd = nullptr;
+    char* relroBegin = nullptr;
+    char* relroEnd = nullptr;
+    for (ElfW(Half) i = 0; i < elfHeader->e_phnum; i++)
+    {
+        char* begin = base + headers[i].p_vaddr;
+        char* end = begin + headers[i].p_memsz;
+        if (headers[i].p_type == PT_LOAD)
+        {
+            imageBegin = imageBegin ? std::min(imageBegin, begin) : begin;
+            imageEnd = std::max(imageEnd, end);
+        }
+        else if (headers[i].p_type == PT_GNU_RELRO)
+        {
+            relroBegin = begin;
+            relroEnd = end;
+        }
+    }
+    if (!imageBegin)
+        return false;
+
+    // writable segments, less the part that the loader makes read only once relocated
+    data.clear();
+    for (ElfW(Half) i = 0; i < elfHeader->e_phnum; i++)
+    {
+        if (headers[i].p_type != PT_LOAD || !(headers[i].p_flags & PF_W))
+            continue;
+        char* begin = base + headers[i].p_vaddr;
+        char* end = begin + headers[i].p_memsz;
+        if (relroEnd <= begin || relroBegin >= end)
+            appendRange(data, begin, end);
+        else
+        {
+            appendRange(data, begin, relroBegin);
+            appendRange(data, relroEnd, end);
+        }
+    }
+    image = { imageBegin, static_cast<size_t>(imageEnd - imageBegin) };
+    return true;
+}
+
+MappedFile::MappedFile(const fs::path& fileName, size_t size)
+    : length(size)
+{
+    int fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        throw std::runtime_error("Could not create " + fileName.string() + ".");
+    if (ftruncate(fd, size) == -1)
+    {
+        close(fd);
+        throw std::runtime_error("Could not size " + fileName.string() + ".");
+    }
+    address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        address = nullptr;
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    }
+}
+
+MappedFile::MappedFile(const fs::path& fileName)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("Could not open " + fileName.string() + ".");
+    struct stat info;
+    if (fstat(fd, &info) == -1 || info.st_size == 0)
+    {
+        close(fd);
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    }
+    length = info.st_size;
+    address = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED)
+    {
+        address = nullptr;
+        throw std::runtime_error("Could not map " + fileName.string() + ".");
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(address, length);
+}
+
+std::wstring lastLibraryError()
+{
+    const char* error = dlerror();
+    return error ? utf8ToUtf16(error) : L"";
+}
+
+std::wstring createUniqueName()
+{
+    // a random (version 4) UUID, formatted like the GUIDs used on Windows
+    std::random_device device;
+    uint32_t words[4];
+    for (auto& word : words)
+        word = device();
+    words[1] = (words[1] & 0xffff0fff) | 0x00004000;
+    words[2] = (words[2] & 0x3fffffff) | 0x80000000;
+
+    wchar_t buff[37];
+    swprintf(
+        buff,
+        sizeof(buff) / sizeof(wchar_t),
+        L"%08x-%04x-%04x-%04x-%04x%08x",
+        words[0],
+        words[1] >> 16,
+        words[1] & 0xffff,
+        words[2] >> 16,
+        words[2] & 0xffff,
+        words[3]
+    );
+    return buff;
+}
+
+// wchar_t holds UTF-32 on Linux
+
+std::string utf16ToUtf8(const std::wstring& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (wchar_t c : value)
+    {
+        uint32_t code = static_cast<uint32_t>(c);
+        if (code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff))
+            throw std::runtime_error("Conversion failure: utf16 to utf8.");
+        if (code < 0x80)
+            result += static_cast<char>(code);
+        else if (code < 0x800)
+        {
+            result += static_cast<char>(0xc0 | (code >> 6));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if (code < 0x10000)
+        {
+            result += static_cast<char>(0xe0 | (code >> 12));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            result += static_cast<char>(0xf0 | (code >> 18));
+            result += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            result += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+    return result;
+}
+
+std::wstring utf8ToUtf16(const std::string value)
+{
+    std::wstring result;
+    result.reserve(value.size());
+    for (size_t i = 0; i < value.size();)
+    {
+        uint8_t lead = static_cast<uint8_t>(value[i]);
+        int length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xe ? 3 : (lead >> 3) == 0x1e ? 4 : 0;
+        if (length == 0 || i + length > value.size())
+            throw std::runtime_error("Conversion failure: utf8 to utf16.");
+        uint32_t code = length == 1 ? lead : lead & (0x7f >> length);
+        for (int j = 1; j < length; j++)
+        {
+            uint8_t next = static_cast<uint8_t>(value[i + j]);
+            if ((next & 0xc0) != 0x80)
+                throw std::runtime_error("Conversion failure: utf8 to utf16.");
+            code = (code << 6) | (next & 0x3f);
+        }
+        result += static_cast<wchar_t>(code);
+        i += length;
+    }
+    return result;
+}
+
+bool convertTo8bitText(const std::wstring& input, char* output, size_t outputLen)
+{
+    // file names are UTF-8 on Linux
+    std::string text;
+    try
+    {
+        text = utf16ToUtf8(input);
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+    if (text.empty() || text.size() > outputLen)
+        return false;
+    std::copy(text.begin(), text.end(), output);
+    return true;
+}
+
+#endif
@@ -0,0 +1,262 @@
+#include "RemoteDiscon.hpp"
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+namespace fs = std::filesystem;
+
+// how often a waiting controller checks that its host process is still alive
+static const int hostCheckMilliseconds = 100;
+
+// how long a host is given to exit cleanly once all its controllers have finished
+static const int hostExitMilliseconds = 5000;
+
+static std::string utf8(const fs::path& path)
+{
+    std::u8string result = path.u8string();
+    return std::string(result.begin(), result.end());
+}
+
+static uint32_t processID()
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return static_cast<uint32_t>(getpid());
+#endif
+}
+
+class DisconHostProcess
+{
+public:
+    DisconHostProcess(const fs::path& hostFileName, uint32_t slotCount, uint32_t index)
+        : hostFileName(hostFileName), slotsInUse(slotCount, false)
+    {
+#ifdef _WIN32
+        name = "Local\\DisconHost-" + std::to_string(processID()) + "-" + std::to_string(index);
+#else
+        name = "/DisconHost-" + std::to_string(processID()) + "-" + std::to_string(index);
+#endif
+        memory = std::make_unique<SharedMemoryBlock>(name, disconHostBlockSize(slotCount));
+        block = new (memory->data()) DisconHostBlock{ disconHostVersion, slotCount };
+        launch();
+    }
+
+    ~DisconHostProcess()
+    {
+        block->shutdown.store(1);
+        for (uint32_t slotIndex = 0; slotIndex < block->slotCount; slotIndex++)
+        {
+            DisconHostSlot& slot = block->slots[slotIndex];
+            DisconHostSignal request(slot.request, slot.hostWaiting, disconHostEventName(name, slotIndex, "request"));
+            request.post(slot.request.load() + 1);
+        }
+        waitForExit();
+    }
+
+    bool alive()
+    {
+#ifdef _WIN32
+        return WaitForSingleObject(process, 0) != WAIT_OBJECT_0;
+#else
+        // several controllers may ask at once, only one of them reaps the host
+        if (exited.load())
+            return false;
+        pid_t result = waitpid(pid, nullptr, WNOHANG);
+        if (result == pid || (result == -1 && errno == ECHILD))
+            exited.store(true);
+        return !exited.load();
+#endif
+    }
+
+    const std::string& getName() const { return name; };
+    DisconHostBlock* getBlock() const { return block; };
+    const fs::path& getHostFileName() const { return hostFileName; };
+
+    bool tryAcquireSlot(uint32_t& slotIndex)
+    {
+        for (slotIndex = 0; slotIndex < slotsInUse.size(); slotIndex++)
+            if (!slotsInUse[slotIndex])
+            {
+                slotsInUse[slotIndex] = true;
+                return true;
+            }
+        return false;
+    }
+
+    void releaseSlot(uint32_t slotIndex)
+    {
+        slotsInUse[slotIndex] = false;
+    }
+private:
+    void launch()
+    {
+        std::string slotCount = std::to_string(block->slotCount);
+        std::string parent = std::to_string(processID());
+#ifdef _WIN32
+        std::wstring commandLine = L"\"" + hostFileName.wstring() + L"\" " + std::wstring(name.begin(), name.end()) + L" " +
+            std::wstring(slotCount.begin(), slotCount.end()) + L" " + std::wstring(parent.begin(), parent.end());
+        STARTUPINFOW startupInfo = { sizeof(startupInfo) };
+        PROCESS_INFORMATION processInfo;
+        if (!CreateProcessW(hostFileName.c_str(), commandLine.data(), nullptr, nullptr, FALSE, CREATE_NO_WINDOW,
+            nullptr, nullptr, &startupInfo, &processInfo))
+            throw std::runtime_error("Could not start controller host " + utf8(hostFileName) + ", error code " +
+                std::to_string(GetLastError()) + ".");
+        CloseHandle(processInfo.hThread);
+        process = processInfo.hProcess;
+#else
+        std::string fileName = hostFileName.string();
+        char* argv[] = { fileName.data(), name.data(), slotCount.data(), parent.data(), nullptr };
+        if (posix_spawn(&pid, fileName.c_str(), nullptr, nullptr, argv, environ) != 0)
+            throw std::runtime_error("Could not start controller host " + fileName + ".");
+#endif
+    }
+
+    void waitForExit()
+    {
+#ifdef _WIN32
+        if (WaitForSingleObject(process, hostExitMilliseconds) != WAIT_OBJECT_0)
+            TerminateProcess(process, 1);
+        CloseHandle(process);
+#else
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(hostExitMilliseconds);
+        while (alive())
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+                exited.store(true);
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+#endif
+    }
+private:
+    fs::path hostFileName;
+    std::string name;
+    std::vector<bool> slotsInUse;
+    std::unique_ptr<SharedMemoryBlock> memory;
+    DisconHostBlock* block = nullptr;
+#ifdef _WIN32
+    HANDLE process = nullptr;
+#else
+    pid_t pid = 0;
+    std::atomic<bool> exited = false;
+#endif
+};
+
+// hosts with free slots are reused by later controllers, a host shuts down once its last controller is destroyed
+static std::mutex hostsMutex;
+static std::vector<std::weak_ptr<DisconHostProcess>> hosts;
+static uint32_t hostsCreated = 0;
+
+RemoteDiscon::RemoteDiscon(const fs::path& hostFileName, const fs::path& dllFileName, uint32_t turbinesPerHost)
+{
+    std::string dllFileNameUtf8 = utf8(dllFileName);
+    if (dllFileNameUtf8.size() >= disconHostPathLength)
+        throw std::runtime_error("Controller DLL file name is too long to pass to the controller host.");
+
+    {
+        std::lock_guard<std::mutex> lock(hostsMutex);
+        for (auto& weakHost : hosts)
+        {
+            std::shared_ptr<DisconHostProcess> candidate = weakHost.lock();
+            if (candidate && candidate->getHostFileName() == hostFileName && candidate->tryAcquireSlot(slotIndex))
+            {
+                host = candidate;
+                break;
+            }
+        }
+        if (!host)
+        {
+            host = std::make_shared<DisconHostProcess>(hostFileName, turbinesPerHost, hostsCreated++);
+            host->tryAcquireSlot(slotIndex);
+            std::erase_if(hosts, [](const std::weak_ptr<DisconHostProcess>& weakHost) { return weakHost.expired(); });
+            hosts.push_back(host);
+        }
+    }
+
+    try
+    {
+        slot = &host->getBlock()->slots[slotIndex];
+        request = std::make_unique<DisconHostSignal>(slot->request, slot->hostWaiting, disconHostEventName(host->getName(), slotIndex, "request"));
+        response = std::make_unique<DisconHostSignal>(slot->response, slot->clientWaiting, disconHostEventName(host->getName(), slotIndex, "response"));
+        sequence = slot->request.load();
+
+        memcpy(slot->dllFileName, dllFileNameUtf8.c_str(), dllFileNameUtf8.size() + 1);
+        execute(DisconHostCommand::attach);
+        if (slot->aviFail < 0)
+            throw std::runtime_error(std::string(slot->avcMsg, strnlen(slot->avcMsg, STRINGLENGTH)));
+    }
+    catch (...)
+    {
+        release();
+        throw;
+    }
+}
+
+RemoteDiscon::~RemoteDiscon()
+{
+    try
+    {
+        execute(DisconHostCommand::detach);
+    }
+    catch (const std::exception&)
+    {
+        // the host has gone, nothing to detach from
+    }
+    release();
+}
+
+void RemoteDiscon::release()
+{
+    std::lock_guard<std::mutex> lock(hostsMutex);
+    host->releaseSlot(slotIndex);
+    host.reset();
+}
+
+void RemoteDiscon::call(float* avrSwap, int* aviFail, const char* accInfile, const char* avcOutfile, char* avcMsg)
+{
+    // the file names do not change during a simulation
+    if (!fileNamesSent)
+    {
+        memcpy(slot->accInfile, accInfile, STRINGLENGTH);
+        memcpy(slot->avcOutfile, avcOutfile, STRINGLENGTH);
+        fileNamesSent = true;
+    }
+    memcpy(slot->avrSwap, avrSwap, sizeof(slot->avrSwap));
+    slot->aviFail = *aviFail;
+
+    execute(DisconHostCommand::call);
+
+    memcpy(avrSwap, slot->avrSwap, sizeof(slot->avrSwap));
+    *aviFail = slot->aviFail;
+    if (*aviFail != 0)
+        memcpy(avcMsg, slot->avcMsg, STRINGLENGTH);
+}
+
+void RemoteDiscon::execute(DisconHostCommand command)
+{
+    slot->command = static_cast<uint32_t>(command);
+    request->post(++sequence);
+    while (!response->waitChange(sequence - 1, hostCheckMilliseconds))
+        if (!host->alive())
+            throw std::runtime_error("Controller host process terminated unexpectedly.");
+}
@@ -0,0 +1,209 @@
+#include "StateSpaceActuator.hpp"
+#include "MatrixExponential.hpp"
+#include "Platform.hpp"
+#include "nlohmann/json.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+static std::vector<double> jsonVector(const json& value, const char* name)
+{
+    if (!value.is_array())
+        throw std::runtime_error(std::string("ActuatorStateSpace ") + name + " must be an array.");
+    return value.get<std::vector<double>>();
+}
+
+StateSpaceModel loadStateSpaceModel(const std::wstring& value, const fs::path& directory)
+{
+    std::string text = utf16ToUtf8(value);
+    if (text.find('{') == std::string::npos)
+    {
+        fs::path fileName = directory / value;
+        std::ifstream file(fileName);
+        if (!file)
+            throw std::runtime_error("Could not read ActuatorStateSpace file " + utf16ToUtf8(fileName.wstring()) + ".");
+        std::stringstream contents;
+        contents << file.rdbuf();
+        text = contents.str();
+    }
+
+    StateSpaceModel model;
+    try
+    {
+        json data = json::parse(text);
+        if (!data.contains("A") || !data.contains("B") || !data.contains("C"))
+            throw std::runtime_error("ActuatorStateSpace must define A, B and C.");
+
+        const json& A = data["A"];
+        model.order = A.size();
+        if (!A.is_array() || model.order < 1 || model.order > StateSpaceActuator::maxOrder)
+            throw std::runtime_error("ActuatorStateSpace A must be a square matrix of order 1 to 6.");
+        for (const json& row : A)
+        {
+            std::vector<double> values = jsonVector(row, "A");
+            if (values.size() != model.order)
+                throw std::runtime_error("ActuatorStateSpace A must be a square matrix of order 1 to 6.");
+            model.A.insert(model.A.end(), values.begin(), values.end());
+        }
+
+        model.B = jsonVector(data["B"], "B");
+        if (model.B.size() != model.order)
+            throw std::runtime_error("ActuatorStateSpace B must have one value per state.");
+
+        const json& C = data["C"];
+        model.outputCount = C.size();
+        if (!C.is_array() || model.outputCount < 1 || model.outputCount > 3)
+            throw std::runtime_error("ActuatorStateSpace C must have one to three rows, for position, velocity and acceleration.");
+        for (const json& row : C)
+        {
+            std::vector<double> values = jsonVector(row, "C");
+            if (values.size() != model.order)
+                throw std::runtime_error("ActuatorStateSpace C rows must have one value per state.");
+            model.C.insert(model.C.end(), values.begin(), values.end());
+        }
+
+        if (data.contains("D"))
+        {
+            model.D = jsonVector(data["D"], "D");
+            if (model.D.size() != model.outputCount)
+                throw std::runtime_error("ActuatorStateSpace D must have one value per row of C.");
+        }
+        else
+            model.D.assign(model.outputCount, 0.0);
+    }
+    catch(const json::exception& exc)
+    {
+        throw std::runtime_error(std::string("Could not parse ActuatorStateSpace JSON, ") + exc.what() + ".");
+    }
+    return model;
+}
+
+template<size_t N>
+class FixedOrderStateSpaceActuator : public StateSpaceActuator
+{
+public:
+    FixedOrderStateSpaceActuator(const StateSpaceModel& model, double dt)
+        : model(model)
+    {
+        cache[0] = discretise(dt);
+    }
+
+    size_t order() const override
+    {
+        return N;
+    }
+
+    ActuatorState output(double input, double dt) override
+    {
+        const Discretisation& d = discretisation(dt);
+        double udot = (input - uprev) / d.dt;
+        std::array<double, N> next;
+        for (size_t i = 0; i < N; i++)
+        {
+            double value = d.B0[i] * uprev + d.B1[i] * udot;
+            for (size_t j = 0; j < N; j++)
+                value += d.Ad[i * N + j] * x[j];
+            next[i] = value;
+        }
+        x = next;
+        uprev = input;
+
+        std::array<double, 3> y = { 0, 0, 0 };
+        for (size_t k = 0; k < model.outputCount; k++)
+        {
+            double value = model.D[k] * input;
+            for (size_t j = 0; j < N; j++)
+                value += model.C[k * N + j] * x[j];
+            y[k] = value;
+        }
+        return { y[0], y[1], y[2] };
+    }
+
+    void getState(double* state, double& input) const override
+    {
+        std::copy(x.begin(), x.end(), state);
+        input = uprev;
+    }
+
+    void setState(const double* state, double input) override
+    {
+        std::copy(state, state + N, x.begin());
+        uprev = input;
+    }
+private:
+    struct Discretisation
+    {
+        double dt;
+        std::array<double, N * N> Ad;
+        std::array<double, N> B0; // applied to the input at the start of the step
+        std::array<double, N> B1; // applied to the rate of change of the input over the step
+    };
+
+    /* The exponential of [A B 0; 0 0 1; 0 0 0] dt, the state augmented with the input and its rate, gives the
+       transition of the state and its response to each. */
+    Discretisation discretise(double dt) const
+    {
+        constexpr size_t M = N + 2;
+        Matrix<M> augmented{};
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t j = 0; j < N; j++)
+                augmented[i * M + j] = model.A[i * N + j] * dt;
+            augmented[i * M + N] = model.B[i] * dt;
+        }
+        augmented[N * M + N + 1] = dt;
+
+        Matrix<M> transition = exponential<M>(augmented);
+        Discretisation result;
+        result.dt = dt;
+        for (size_t i = 0; i < N; i++)
+        {
+            for (size_t j = 0; j < N; j++)
+                result.Ad[i * N + j] = transition[i * M + j];
+            result.B0[i] = transition[i * M + N];
+            result.B1[i] = transition[i * M + N + 1];
+        }
+        return result;
+    }
+
+    const Discretisation& discretisation(double dt)
+    {
+        for (size_t i = 0; i < cacheCount; i++)
+            if (sameTimeStep(dt, cache[i].dt))
+                return cache[i];
+
+        // replace the least recently added entry, keeping the first
+        Discretisation& entry = cache[nextCacheEntry];
+        entry = discretise(dt);
+        cacheCount = std::max(cacheCount, nextCacheEntry + 1);
+        nextCacheEntry = nextCacheEntry + 1 < cache.size() ? nextCacheEntry + 1 : 1;
+        return entry;
+    }
+private:
+    StateSpaceModel model;
+    std::array<double, N> x = {};
+    double uprev = 0;
+    std::array<Discretisation, 4> cache; // the first is for the time step given at creation
+    size_t nextCacheEntry = 1;
+    size_t cacheCount = 1;
+};
+
+std::unique_ptr<StateSpaceActuator> createStateSpaceActuator(const StateSpaceModel& model, double dt)
+{
+    switch (model.order)
+    {
+    case 1: return std::make_unique<FixedOrderStateSpaceActuator<1>>(model, dt);
+    case 2: return std::make_unique<FixedOrderStateSpaceActuator<2>>(model, dt);
+    case 3: return std::make_unique<FixedOrderStateSpaceActuator<3>>(model, dt);
+    case 4: return std::make_unique<FixedOrderStateSpaceActuator<4>>(model, dt);
+    case 5: return std::make_unique<FixedOrderStateSpaceActuator<5>>(model, dt);
+    case 6: return std::make_unique<FixedOrderStateSpaceActuator<6>>(model, dt);
+    default: throw std::runtime_error("ActuatorStateSpace A must be a square matrix of order 1 to 6.");
+    }
+}
@@ -0,0 +1,43 @@
+#include "SwapLog.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// checks the layout before the file is created
+static size_t logFileSize(const std::vector<size_t>& records, uint64_t rowCapacity)
+{
+    if (records.empty() || records.size() > swapRecordCount)
+        throw std::runtime_error("ControllerLogRecords must list between 1 and " + std::to_string(swapRecordCount) + " records.");
+    for (size_t record : records)
+        if (record < 1 || record > swapRecordCount)
+            throw std::runtime_error("ControllerLogRecords must be avrSwap records from 1 to " + std::to_string(swapRecordCount) + ".");
+    return swapLogHeaderSize() + rowCapacity * swapLogRowSize(records.size());
+}
+
+SwapLogWriter::SwapLogWriter(const fs::path& fileName, const std::vector<size_t>& records, uint64_t rowCapacity,
+    uint32_t decimation, const std::wstring& turbineName)
+    : file(fileName, logFileSize(records, rowCapacity)),
+      rowSize(swapLogRowSize(records.size())), rowCapacity(rowCapacity), decimation(decimation),
+      columnCount(records.size()), records{}
+{
+    header = static_cast<SwapLogHeader*>(file.data());
+    rows = static_cast<char*>(file.data()) + swapLogHeaderSize();
+    for (size_t i = 0; i < columnCount; i++)
+        this->records[i] = static_cast<uint32_t>(records[i] - 1);
+
+    // the file is zero filled, so the row count starts at zero
+    memcpy(header->tag, swapLogTag, sizeof(header->tag));
+    header->version = swapLogVersion;
+    header->headerSize = swapLogHeaderSize();
+    header->rowSize = rowSize;
+    header->columnCount = static_cast<uint32_t>(columnCount);
+    header->decimation = decimation;
+    header->rowCapacity = rowCapacity;
+    for (size_t i = 0; i < columnCount; i++)
+        header->records[i] = static_cast<uint32_t>(records[i]);
+    std::string name = utf16ToUtf8(turbineName);
+    memcpy(header->turbineName, name.data(), std::min(name.size(), swapLogNameLength - 1));
+}
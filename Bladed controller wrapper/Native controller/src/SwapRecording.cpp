@@ -0,0 +1,74 @@
+#include "SwapRecording.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// frames held in memory between writes, about 350 kB
+static const size_t blockFrameCount = 1024;
+
+SwapRecordingWriter::SwapRecordingWriter(const fs::path& fileName, const char* accInfile, const char* avcOutfile)
+    : fileName(fileName), file(fileName, std::ios::binary | std::ios::trunc), frames(blockFrameCount)
+{
+    if (!file)
+        throw std::runtime_error("Could not create controller recording " + fileName.string() + ".");
+
+    SwapRecordingHeader header = {};
+    memcpy(header.tag, swapRecordingTag, sizeof(header.tag));
+    header.version = swapRecordingVersion;
+    header.recordCount = swapRecordCount;
+    header.frameSize = sizeof(SwapFrame);
+    memcpy(header.accInfile, accInfile, STRINGLENGTH);
+    memcpy(header.avcOutfile, avcOutfile, STRINGLENGTH);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!file)
+        throw std::runtime_error("Could not write controller recording " + fileName.string() + ".");
+}
+
+void SwapRecordingWriter::write(double time, double dt, const float* avrSwap)
+{
+    SwapFrame& frame = frames[frameCount++];
+    frame.time = time;
+    frame.dt = dt;
+    memcpy(frame.avrSwap, avrSwap, sizeof(frame.avrSwap));
+    if (frameCount == frames.size())
+        flush();
+}
+
+void SwapRecordingWriter::flush()
+{
+    if (frameCount == 0)
+        return;
+    file.write(reinterpret_cast<const char*>(frames.data()), frameCount * sizeof(SwapFrame));
+    frameCount = 0;
+    file.flush();
+    if (!file)
+        throw std::runtime_error("Could not write controller recording " + fileName.string() + ".");
+}
+
+SwapRecordingReader::SwapRecordingReader(const fs::path& fileName)
+    : fileName(fileName), file(fileName, std::ios::binary), frames(blockFrameCount)
+{
+    if (!file)
+        throw std::runtime_error("Could not open controller recording " + fileName.string() + ".");
+    if (!file.read(reinterpret_cast<char*>(&recordingHeader), sizeof(recordingHeader))
+        || memcmp(recordingHeader.tag, swapRecordingTag, sizeof(swapRecordingTag)) != 0)
+        throw std::runtime_error(fileName.string() + " is not a controller recording.");
+    if (recordingHeader.version != swapRecordingVersion || recordingHeader.recordCount != swapRecordCount
+        || recordingHeader.frameSize != sizeof(SwapFrame))
+        throw std::runtime_error("Controller recording " + fileName.string() + " was written by a different version of the wrapper.");
+}
+
+const SwapFrame* SwapRecordingReader::next()
+{
+    if (position == frameCount)
+    {
+        file.read(reinterpret_cast<char*>(frames.data()), frames.size() * sizeof(SwapFrame));
+        frameCount = static_cast<size_t>(file.gcount()) / sizeof(SwapFrame);
+        position = 0;
+        if (frameCount == 0)
+            return nullptr;
+    }
+    return &frames[position++];
+}
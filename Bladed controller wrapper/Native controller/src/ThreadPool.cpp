@@ -0,0 +1,74 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned workerCount)
+{
+    for (unsigned i = 0; i < workerCount; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    started.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::run(size_t count, Task task, void* context)
+{
+    if (count == 0)
+        return;
+
+    std::lock_guard<std::mutex> runLock(runMutex);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = task;
+        this->context = context;
+        this->count = count;
+        nextIndex.store(0);
+        busyWorkers = static_cast<unsigned>(workers.size());
+        generation++;
+    }
+    started.notify_all();
+
+    runTasks();
+
+    // every worker checks in, even if there was nothing left for it, so the batch is not touched after we return
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void ThreadPool::work()
+{
+    unsigned lastGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.wait(lock, [&] { return stopping || generation != lastGeneration; });
+            if (stopping)
+                return;
+            lastGeneration = generation;
+        }
+
+        runTasks();
+
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            last = --busyWorkers == 0;
+        }
+        if (last)
+            finished.notify_one();
+    }
+}
+
+void ThreadPool::runTasks()
+{
+    size_t index;
+    while ((index = nextIndex.fetch_add(1)) < count)
+        task(context, index);
+}
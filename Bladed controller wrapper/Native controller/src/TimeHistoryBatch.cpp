@@ -0,0 +1,59 @@
+#include "TimeHistoryBatch.hpp"
+#include <algorithm>
+
+TimeHistoryBatch::TimeHistoryBatch()
+    : period(Period(pnInstantaneousValue))
+{
+}
+
+int TimeHistoryBatch::add(const OrcaFlexObject& modelObject, const std::wstring& varName)
+{
+    return add(modelObject, varName, nullptr);
+}
+
+int TimeHistoryBatch::add(const OrcaFlexObject& modelObject, const std::wstring& varName, const ObjectExtra& objectExtra)
+{
+    // deque elements are never relocated, so pointers into them remain valid as further results are added
+    objectExtras.push_back(objectExtra);
+    apiObjectExtras.push_back(objectExtras.back());
+    return add(modelObject, varName, &apiObjectExtras.back());
+}
+
+int TimeHistoryBatch::add(const OrcaFlexObject& modelObject, const std::wstring& varName, TObjectExtra2* objectExtra)
+{
+    int status;
+    int varID;
+    C_GetVarID(modelObject.getHandle(), varName.c_str(), &varID, &status);
+    checkStatus(status);
+    specification.push_back({ modelObject.getHandle(), objectExtra, varID });
+    values.push_back(0);
+    return size() - 1;
+}
+
+TObjectExtra2& TimeHistoryBatch::objectExtra(int index)
+{
+    return *specification[index].lpObjectExtra;
+}
+
+int TimeHistoryBatch::append(const TimeHistoryBatch& other)
+{
+    int offset = size();
+    specification.insert(specification.end(), other.specification.begin(), other.specification.end());
+    values.resize(specification.size());
+    return offset;
+}
+
+void TimeHistoryBatch::assignValues(const TimeHistoryBatch& source, int offset)
+{
+    std::copy_n(source.values.begin() + offset, values.size(), values.begin());
+}
+
+void TimeHistoryBatch::fetch()
+{
+    if (specification.empty())
+        return;
+
+    int status;
+    C_GetMultipleTimeHistories(size(), &specification[0], &period, &values[0], &status);
+    checkStatus(status);
+}
@@ -0,0 +1,143 @@
+#include "TraceRecorder.hpp"
+#include "Platform.hpp"
+#include "Utils.hpp"
+#include "nlohmann/json.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+std::mutex TraceSession::sessionMutex;
+std::weak_ptr<TraceSession> TraceSession::openSession;
+std::atomic<uint64_t> TraceSession::sessionCount = 0;
+
+// the block a thread is filling, identified by session generation so that a new session is never written to the
+// block of an old one
+struct ThreadTraceBlock
+{
+    uint64_t generation = 0;
+    size_t blockIndex = 0;
+    uint32_t thread = 0;
+    bool exhausted = false;
+};
+
+static thread_local ThreadTraceBlock threadBlock;
+
+std::shared_ptr<TraceSession> TraceSession::join(const fs::path& fileName, size_t eventBudget)
+{
+    std::lock_guard<std::mutex> lock(sessionMutex);
+    std::shared_ptr<TraceSession> session = openSession.lock();
+    if (session)
+    {
+        if (session->fileName() != fileName)
+            throw std::runtime_error("ControllerTraceFile must name the same file for every traced turbine.");
+        return session;
+    }
+    session = std::make_shared<TraceSession>(fileName, eventBudget);
+    openSession = session;
+    return session;
+}
+
+TraceSession::TraceSession(const fs::path& fileName, size_t eventBudget)
+    : path(fileName), generation(++sessionCount), blockCount((eventBudget + blockSize - 1) / blockSize),
+    events(std::make_unique_for_overwrite<Event[]>(blockCount * blockSize)), blocks(std::make_unique<Block[]>(blockCount)),
+    startTicks(timestamp()), startTime(std::chrono::steady_clock::now())
+{
+}
+
+TraceSession::~TraceSession()
+{
+    writeDiagnostic(L"the controller trace", [this] { write(); });
+}
+
+uint32_t TraceSession::addTurbine(const std::wstring& name)
+{
+    std::lock_guard<std::mutex> lock(turbinesMutex);
+    turbines.push_back(name);
+    return static_cast<uint32_t>(turbines.size() - 1);
+}
+
+TraceSession::Block* TraceSession::claim(size_t& blockIndex)
+{
+    ThreadTraceBlock& current = threadBlock;
+    if (current.generation != generation)
+    {
+        current = { generation, 0, threadCount.fetch_add(1), false };
+        current.blockIndex = nextBlock.fetch_add(1);
+    }
+    else if (current.exhausted)
+        return nullptr;
+    else if (blocks[current.blockIndex].count.load(std::memory_order_relaxed) == blockSize)
+        current.blockIndex = nextBlock.fetch_add(1);
+
+    if (current.blockIndex >= blockCount)
+    {
+        current.exhausted = true;
+        return nullptr;
+    }
+    blockIndex = current.blockIndex;
+    Block& block = blocks[blockIndex];
+    block.thread = current.thread;
+    return &block;
+}
+
+void TraceSession::record(uint64_t ticks, double simulationTime, uint32_t turbine, Phase phase, bool begin) noexcept
+{
+    size_t blockIndex;
+    Block* block = claim(blockIndex);
+    if (!block)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    uint32_t count = block->count.load(std::memory_order_relaxed);
+    events[blockIndex * blockSize + count] = { ticks, simulationTime, turbine, phase, begin };
+    block->count.store(count + 1, std::memory_order_release);
+}
+
+void TraceSession::write() const
+{
+    using json = nlohmann::json;
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    uint64_t ticks = timestamp() - startTicks;
+    double microsecondsPerTick = ticks > 0 ? 1e6 * seconds / ticks : 0;
+
+    std::vector<std::string> turbineNames;
+    for (const std::wstring& name : turbines)
+        turbineNames.push_back(json(utf16ToUtf8(name)).dump());
+    std::vector<std::string> phaseNames;
+    for (size_t i = 0; i < phaseCount; i++)
+        phaseNames.push_back(json(utf16ToUtf8(phaseName(static_cast<Phase>(i)))).dump());
+
+    std::ofstream file(path);
+    if (!file)
+        throw std::runtime_error("Could not write ControllerTraceFile " + utf16ToUtf8(path.wstring()) + ".");
+    file.precision(15);
+    file << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (uint32_t thread = 0; thread < threadCount.load(); thread++)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+            << ",\"args\":{\"name\":\"thread " << thread << "\"}}";
+        first = false;
+    }
+    size_t usedBlocks = std::min(nextBlock.load(), blockCount);
+    for (size_t blockIndex = 0; blockIndex < usedBlocks; blockIndex++)
+    {
+        const Block& block = blocks[blockIndex];
+        uint32_t count = block.count.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            const Event& event = events[blockIndex * blockSize + i];
+            file << (first ? "" : ",\n") << "{\"name\":" << phaseNames[static_cast<size_t>(event.phase)]
+                << ",\"cat\":\"controller\",\"ph\":\"" << (event.begin ? 'B' : 'E') << "\",\"ts\":"
+                << microsecondsPerTick * static_cast<double>(event.ticks - startTicks) << ",\"pid\":1,\"tid\":" << block.thread;
+            if (event.begin)
+                file << ",\"args\":{\"turbine\":" << turbineNames[event.turbine] << ",\"simulationTime\":" << event.simulationTime << "}";
+            file << "}";
+            first = false;
+        }
+    }
+    file << "\n],\n\"otherData\":{\"eventBudget\":" << blockCount * blockSize << ",\"droppedEvents\":" << dropped.load() << "}}\n";
+}
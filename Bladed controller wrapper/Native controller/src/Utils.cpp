@@ -23,28 +23,6 @@ bool checkStatus(TExtFnInfo& info, const std::wstring context, int status)
     return false;
 }
 
-std::string utf16ToUtf8(const std::wstring& value)
-{
-    std::string result;
-    int retval = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), value.size(), nullptr, 0, nullptr, nullptr);
-    result.resize(retval);
-    retval = WideCharToMultiByte(CP_UTF8, 0, value.c_str(), value.size(), result.data(), retval, nullptr, nullptr);
-    if (value.size() > 0 && retval == 0)
-        throw std::runtime_error("Conversion failure: utf16 to utf8.");
-    return result;
-}
-
-std::wstring utf8ToUtf16(const std::string value)
-{
-    std::wstring result;
-    int retval = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), value.size(), nullptr, 0);
-    result.resize(retval);
-    retval = MultiByteToWideChar(CP_UTF8, 0, value.c_str(), value.size(), result.data(), retval);
-    if (value.size() > 0 && retval == 0)
-        throw std::runtime_error("Conversion failure: utf8 to utf16.");
-    return result;
-}
-
 std::wstring trim(const std::wstring& str)
 {
     // treat any character <= space (ASCII 0x20) as whitespace, covering
@@ -104,7 +82,7 @@ double suppressRangeJumps(const double previous, const double value)
     return value;
 }
 
-ControlledVar controlledVar(const std::wstring dataName)
+ControlledVar controlledVar(const std::wstring_view dataName)
 {
     if (dataName == L"PitchController")
         return ControlledVar::pitch;
@@ -120,4 +98,26 @@ bool TryStrToDouble(const std::string& text, double& value)
     auto ptr = text.c_str();
     auto retval = std::from_chars(ptr + first, ptr + last, value);
     return retval.ec == std::errc() && retval.ptr == ptr + last;
-}
\ No newline at end of file
+}
+
+bool getBoolFromTag(const OrcaFlexObject& modelObject, const std::wstring& name)
+{
+    std::wstring value;
+    if (!modelObject.tryGetTag(name, value) || value == L"False")
+        return false;
+    if (value == L"True")
+        return true;
+    throw std::runtime_error("Unrecognised value for " + utf16ToUtf8(name) + " tag: must be False or True.");
+}
+
+double getDoubleFromTag(const OrcaFlexObject& modelObject, const std::wstring& name)
+{
+    std::wstring wtext;
+    if (!modelObject.tryGetTag(name, wtext))
+        throw std::runtime_error(utf16ToUtf8(name) + " tag must be defined.");
+    std::string text = utf16ToUtf8(wtext);
+    double result;
+    if (!TryStrToDouble(text, result))
+        throw std::runtime_error("Cannot convert " + utf16ToUtf8(name) + " tag of " + text + " to numeric value.");
+    return result;
+}
@@ -0,0 +1,142 @@
+/* Lists the controllers running on this machine that publish live counters, enabled per turbine with the
+   ControllerCounters tag, one line per turbine. A controller whose process has gone, or that has not finished
+   a time step for longer than the stall time, is marked as such, as is one stopped part way through publishing
+   its counters (torn). Segments left by processes that have gone can be removed with --clean.
+
+   Usage: ControllerMonitor [--watch <seconds>] [--stall <seconds>] [--clean] */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ControllerCounters.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <sys/mman.h>
+
+namespace fs = std::filesystem;
+
+struct Snapshot
+{
+    std::string segment;
+    uint32_t processID;
+    std::string turbineName;
+    std::string modelFileName;
+    bool alive;
+    bool consistent; // false if the values were torn by a writer that stopped part way through
+    ControllerCounterValues values;
+};
+
+// a writer takes well under a microsecond to publish, so this many failed reads means it stopped part way
+static const int readAttempts = 1000;
+
+static bool processAlive(uint32_t pid)
+{
+    return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+}
+
+/* a consistent copy of the counters, retried while the controller is part way through writing them, false if
+   none was found: a controller killed while publishing leaves the sequence odd for good */
+static bool readCounters(const ControllerCountersBlock& block, bool alive, ControllerCounterValues& result)
+{
+    for (int attempt = 0; attempt < (alive ? readAttempts : 1); attempt++)
+    {
+        uint32_t before = block.sequence.load(std::memory_order_acquire);
+        memcpy(&result, &block.values, sizeof(result));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (before % 2 == 0 && block.sequence.load(std::memory_order_relaxed) == before)
+            return true;
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+static std::vector<Snapshot> readAll()
+{
+    std::vector<Snapshot> result;
+    const std::string prefix = controllerCountersPrefix + 1; // without the leading slash
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator("/dev/shm", error))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, prefix.size(), prefix) != 0 || entry.file_size(error) != controllerCountersBlockSize())
+            continue;
+        try
+        {
+            SharedMemoryBlock memory("/" + name);
+            const ControllerCountersBlock& block = *static_cast<const ControllerCountersBlock*>(memory.data());
+            if (block.version != controllerCountersVersion)
+                continue;
+            std::string turbineName(block.turbineName, strnlen(block.turbineName, sizeof(block.turbineName)));
+            std::string modelFileName(block.modelFileName, strnlen(block.modelFileName, sizeof(block.modelFileName)));
+            Snapshot snapshot = { "/" + name, block.processID, turbineName, modelFileName, processAlive(block.processID) };
+            snapshot.consistent = readCounters(block, snapshot.alive, snapshot.values);
+            snapshot.values.avcMsg[STRINGLENGTH - 1] = 0;
+            result.push_back(snapshot);
+        }
+        catch (const std::exception&)
+        {
+            // the controller finished as we looked
+        }
+    }
+    return result;
+}
+
+static void list(double stallSeconds, bool clean)
+{
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    printf("%-8s %-24s %-8s %12s %10s %10s %10s %8s  %s\n",
+        "pid", "turbine", "state", "sim time", "steps/s", "DISCON s", "API s", "aviFail", "model / avcMsg");
+    for (const Snapshot& snapshot : readAll())
+    {
+        const ControllerCounterValues& values = snapshot.values;
+        bool alive = snapshot.alive;
+        double age = 1e-9 * (now - values.updateTime);
+        const char* state = !alive ? "exited" : !snapshot.consistent ? "torn" :
+            values.timeSteps == 0 ? "starting" : age > stallSeconds ? "stalled" : "running";
+        double secondsPerTick = values.ticksPerSecond > 0 ? 1 / values.ticksPerSecond : 0;
+        printf("%-8u %-24.24s %-8s %12.3f %10.1f %10.3f %10.3f %8d  %s\n",
+            snapshot.processID, snapshot.turbineName.c_str(), state, values.simulationTime, values.stepsPerSecond,
+            secondsPerTick * values.disconTicks, secondsPerTick * values.sensorTicks, values.aviFail, snapshot.modelFileName.c_str());
+        if (values.avcMsg[0])
+            printf("%*s%s\n", 103, "", values.avcMsg);
+        if (!alive && clean)
+            shm_unlink(snapshot.segment.c_str());
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    double watchSeconds = 0;
+    double stallSeconds = 60;
+    bool clean = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc)
+            watchSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--stall") == 0 && i + 1 < argc)
+            stallSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--clean") == 0)
+            clean = true;
+        else
+        {
+            fprintf(stderr, "Usage: ControllerMonitor [--watch <seconds>] [--stall <seconds>] [--clean]\n");
+            return 1;
+        }
+    }
+
+    while (true)
+    {
+        list(stallSeconds, clean);
+        if (watchSeconds <= 0)
+            return 0;
+        std::this_thread::sleep_for(std::chrono::duration<double>(watchSeconds));
+        printf("\n");
+    }
+}
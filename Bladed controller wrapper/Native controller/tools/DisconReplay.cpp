@@ -0,0 +1,138 @@
+/* Runs a Bladed style controller DLL open loop on the inputs recorded by the wrapper, enabled per turbine with
+   the ControllerRecordFile tag, so that controller variants and parameters can be compared without running
+   the simulation again. Each recorded call is replayed with avrSwap as the wrapper passed it, and, with
+   --output, avrSwap as DISCON returned it is written to a recording of the same format. The controller's
+   parameter file defaults to the one recorded and can be replaced with --infile. The controller's own output
+   file is named after the output recording, or the recording with _replay added, so that the original run's
+   files are left alone, unless --outfile names it.
+
+   Usage: DisconReplay <recording> <controller DLL> [--infile <file>] [--outfile <file>] [--output <recording>] */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include "Platform.hpp"
+#include "SwapRecording.hpp"
+#include <windows.h> // for __cdecl, from include/posix on Linux
+
+typedef void (__cdecl *discon_func)(float*, int*, char*, char*, char*);
+
+namespace fs = std::filesystem;
+
+// 1-based, see SwapRecords.hpp
+static const int statusRecord = 1;
+static const int infileLengthRecord = 50;
+static const int outfileLengthRecord = 51;
+
+static void usage()
+{
+    fprintf(stderr, "Usage: DisconReplay <recording> <controller DLL> [--infile <file>] [--outfile <file>] [--output <recording>]\n");
+}
+
+static void setText(char* destination, const std::string& value, const char* description)
+{
+    if (value.size() >= STRINGLENGTH)
+        throw std::runtime_error(std::string(description) + " is too long.");
+    memset(destination, 0, STRINGLENGTH);
+    memcpy(destination, value.data(), value.size());
+}
+
+static int replay(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        usage();
+        return 1;
+    }
+    fs::path recordingFileName = argv[1];
+    fs::path dllFileName = argv[2];
+    const char* infile = nullptr;
+    const char* outfile = nullptr;
+    const char* outputFileName = nullptr;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--infile") == 0 && i + 1 < argc)
+            infile = argv[++i];
+        else if (strcmp(argv[i], "--outfile") == 0 && i + 1 < argc)
+            outfile = argv[++i];
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            outputFileName = argv[++i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    SwapRecordingReader recording(recordingFileName);
+    char accInfile[STRINGLENGTH] = { 0 };
+    char avcOutfile[STRINGLENGTH] = { 0 };
+    char avcMsg[STRINGLENGTH] = { 0 };
+    memcpy(accInfile, recording.header().accInfile, STRINGLENGTH);
+    if (infile)
+        setText(accInfile, infile, "Input file name");
+    if (outfile)
+        setText(avcOutfile, outfile, "Output file name");
+    else
+    {
+        // with the five characters the wrapper adds, which ROSCO replaces with its own suffix
+        fs::path base = outputFileName ? fs::path(outputFileName).replace_extension()
+            : fs::path(recordingFileName).replace_extension().concat("_replay");
+        setText(avcOutfile, base.string() + "_     ", "Output file name");
+    }
+
+    LibraryHandle lib = loadLibrary(nativeLibraryFileName(dllFileName));
+    if (!lib)
+        throw std::runtime_error("Could not load " + dllFileName.string() + ", " + utf16ToUtf8(lastLibraryError()));
+    discon_func discon = reinterpret_cast<discon_func>(librarySymbol(lib, "DISCON"));
+    if (!discon)
+        throw std::runtime_error("Could not find DISCON in " + dllFileName.string() + ".");
+
+    std::unique_ptr<SwapRecordingWriter> output;
+    if (outputFileName)
+        output = std::make_unique<SwapRecordingWriter>(outputFileName, accInfile, avcOutfile);
+
+    float avrSwap[swapRecordCount];
+    size_t calls = 0;
+    int aviFail = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (const SwapFrame* frame = recording.next())
+    {
+        memcpy(avrSwap, frame->avrSwap, sizeof(avrSwap));
+        avrSwap[infileLengthRecord - 1] = static_cast<float>(strlen(accInfile));
+        avrSwap[outfileLengthRecord - 1] = static_cast<float>(strlen(avcOutfile));
+        aviFail = 0;
+        discon(avrSwap, &aviFail, accInfile, avcOutfile, avcMsg);
+        calls++;
+        if (aviFail < 0)
+        {
+            fprintf(stderr, "DISCON failed at time %g (iStatus %g):\n%.*s\n", frame->time,
+                frame->avrSwap[statusRecord - 1], STRINGLENGTH, avcMsg);
+            return 1;
+        }
+        if (output)
+            output->write(frame->time, frame->dt, avrSwap);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (output)
+        output->flush();
+    printf("%zu calls in %.3f s, %.0f calls/s\n", calls, seconds, seconds > 0 ? calls / seconds : 0.0);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        return replay(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
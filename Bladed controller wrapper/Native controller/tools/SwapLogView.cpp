@@ -0,0 +1,155 @@
+/* Prints the rows of an avrSwap log, written by the wrapper for turbines with the ControllerLogFile tag, as
+   text with a column per record. The log can be read while the simulation runs: by default the latest rows are
+   printed, and with --follow new rows are printed as they are written until interrupted.
+
+   Usage: SwapLogView <log file> [--rows <count>] [--follow] */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Platform.hpp"
+#include "SwapLog.hpp"
+
+static const int followMilliseconds = 200;
+
+static void usage()
+{
+    fprintf(stderr, "Usage: SwapLogView <log file> [--rows <count>] [--follow]\n");
+}
+
+class SwapLogReader
+{
+public:
+    explicit SwapLogReader(const char* fileName) : file(fileName)
+    {
+        header = static_cast<const SwapLogHeader*>(file.data());
+        if (file.size() < sizeof(SwapLogHeader) || memcmp(header->tag, swapLogTag, sizeof(swapLogTag)) != 0)
+            throw std::runtime_error(std::string(fileName) + " is not an avrSwap log.");
+        if (header->version != swapLogVersion || header->rowSize != swapLogRowSize(header->columnCount)
+            || file.size() < header->headerSize + header->rowCapacity * header->rowSize)
+            throw std::runtime_error(std::string(fileName) + " was written by a different version of the wrapper.");
+        rows = static_cast<const char*>(file.data()) + header->headerSize;
+    }
+
+    const SwapLogHeader& info() const { return *header; }
+
+    uint64_t rowsWritten() const { return header->rowsWritten.load(std::memory_order_acquire); }
+
+    /* copies rows [first, end) that are still held, into buffer, and returns the index of the first copied: rows
+       the writer overwrote while they were copied are dropped */
+    uint64_t read(uint64_t first, uint64_t end, std::vector<char>& buffer) const
+    {
+        if (end - first > header->rowCapacity)
+            first = end - header->rowCapacity;
+        buffer.resize((end - first) * header->rowSize);
+        for (uint64_t row = first; row < end; row++)
+            memcpy(&buffer[(row - first) * header->rowSize], rows + (row % header->rowCapacity) * header->rowSize, header->rowSize);
+
+        // the row being written after this count replaces the one a capacity before it
+        uint64_t after = rowsWritten();
+        uint64_t oldestIntact = after + 1 > header->rowCapacity ? after + 1 - header->rowCapacity : 0;
+        if (oldestIntact > first)
+        {
+            uint64_t dropped = std::min(oldestIntact, end) - first;
+            buffer.erase(buffer.begin(), buffer.begin() + dropped * header->rowSize);
+            first += dropped;
+        }
+        return first;
+    }
+private:
+    MappedFile file;
+    const SwapLogHeader* header;
+    const char* rows;
+};
+
+static void printRows(const SwapLogHeader& header, const std::vector<char>& buffer)
+{
+    for (size_t offset = 0; offset < buffer.size(); offset += header.rowSize)
+    {
+        double time;
+        memcpy(&time, &buffer[offset], sizeof(time));
+        printf("%12.4f", time);
+        for (uint32_t i = 0; i < header.columnCount; i++)
+        {
+            float value;
+            memcpy(&value, &buffer[offset + sizeof(time) + i * sizeof(float)], sizeof(value));
+            printf(" %13.6g", value);
+        }
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+static int view(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        usage();
+        return 1;
+    }
+    uint64_t rowCount = 20;
+    bool follow = false;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc)
+            rowCount = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--follow") == 0)
+            follow = true;
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    SwapLogReader log(argv[1]);
+    const SwapLogHeader& header = log.info();
+    printf("%s: %llu rows written, capacity %llu, every %u DISCON calls\n",
+        std::string(header.turbineName, strnlen(header.turbineName, sizeof(header.turbineName))).c_str(),
+        static_cast<unsigned long long>(log.rowsWritten()), static_cast<unsigned long long>(header.rowCapacity),
+        header.decimation);
+    printf("%12s", "time");
+    for (uint32_t i = 0; i < header.columnCount; i++)
+        printf(" %13s", ("Record " + std::to_string(header.records[i])).c_str());
+    printf("\n");
+
+    std::vector<char> buffer;
+    uint64_t end = log.rowsWritten();
+    log.read(end > rowCount ? end - rowCount : 0, end, buffer);
+    printRows(header, buffer);
+    while (follow)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(followMilliseconds));
+        uint64_t latest = log.rowsWritten();
+        if (latest == end)
+            continue;
+        if (latest < end)
+            end = 0; // the simulation was run again
+        uint64_t first = log.read(end, latest, buffer);
+        if (first > end)
+            printf("(%llu rows overwritten before they were read)\n", static_cast<unsigned long long>(first - end));
+        printRows(header, buffer);
+        end = latest;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        return view(argc, argv);
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -1,6 +1,7 @@
 import numpy
 import math
 import json
+import struct
 from collections import namedtuple
 
 """
@@ -33,6 +34,14 @@ def getBooleanTagValue(modelObject, name):
 
 ActuatorState = namedtuple("ActuatorState", ["x", "xdot", "xdotdot"])
 
+# Stored state is binary, so that it is quick to write and resumes bit for bit: a tag and version, the engine state
+# and then, if used, the actuator state. JSON lists written by earlier versions of this module are still read.
+stateTag = b"NRCS"
+stateVersion = 1
+stateHeader = struct.Struct("<4sI")
+engineState = struct.Struct("<9d")
+actuatorState = struct.Struct("<4d")
+
 
 class Actuator(object):
     def __init__(self, omega, gamma, dt):
@@ -178,22 +187,61 @@ class ControllerEngine(object):
             self.torqueCom = 0.0
             self.errorIntegral = 0.0
         else:
-            stateData = json.loads(info.StateData)
-            self.lastUpdateTime = stateData[0]
-            self.filteredSpeed = stateData[1]
-            self.pitchCom = stateData[2]
-            self.torqueCom = stateData[3]
-            self.errorIntegral = stateData[4]
-            self.pitch = stateData[5]
-            self.pitchDot = stateData[6]
-            self.pitchDotDot = stateData[7]
-            self.torque = stateData[8]
-            if self.useActuator:
-                self.actuator.uprev = stateData[9]
-                self.actuator.prevState = ActuatorState(*stateData[10])
+            stateData = info.StateData
+            if not isinstance(stateData, str):
+                stateData = memoryview(stateData).cast("B")
+            if isinstance(stateData, memoryview) and stateData[:4] == stateTag:
+                self.restoreBinaryState(stateData)
+            else:
+                if isinstance(stateData, memoryview):
+                    stateData = stateData.tobytes().decode()
+                self.restoreJsonState(json.loads(stateData))
+
+    def restoreBinaryState(self, stateData):
+        tag, version = stateHeader.unpack_from(stateData)
+        if version != stateVersion:
+            raise Exception("Unsupported stored state version: {}".format(version))
+        offset = stateHeader.size
+        (
+            self.lastUpdateTime,
+            self.filteredSpeed,
+            self.pitchCom,
+            self.torqueCom,
+            self.errorIntegral,
+            self.pitch,
+            self.pitchDot,
+            self.pitchDotDot,
+            self.torque,
+        ) = engineState.unpack_from(stateData, offset)
+        offset += engineState.size
+        if self.useActuator:
+            uprev, x, xdot, xdotdot = actuatorState.unpack_from(stateData, offset)
+            self.actuator.uprev = uprev
+            self.actuator.prevState = ActuatorState(x, xdot, xdotdot)
+
+    def restoreJsonState(self, stateData):
+        self.lastUpdateTime = stateData[0]
+        self.filteredSpeed = stateData[1]
+        self.pitchCom = stateData[2]
+        self.torqueCom = stateData[3]
+        self.errorIntegral = stateData[4]
+        self.pitch = stateData[5]
+        self.pitchDot = stateData[6]
+        self.pitchDotDot = stateData[7]
+        self.torque = stateData[8]
+        if self.useActuator:
+            self.actuator.uprev = stateData[9]
+            self.actuator.prevState = ActuatorState(*stateData[10])
 
     def storeState(self, info):
-        toDump = [
+        size = stateHeader.size + engineState.size
+        if self.useActuator:
+            size += actuatorState.size
+        stateData = bytearray(size)
+        stateHeader.pack_into(stateData, 0, stateTag, stateVersion)
+        engineState.pack_into(
+            stateData,
+            stateHeader.size,
             self.lastUpdateTime,
             self.filteredSpeed,
             self.pitchCom,
@@ -203,10 +251,15 @@ class ControllerEngine(object):
             self.pitchDot,
             self.pitchDotDot,
             self.torque,
-        ]
+        )
         if self.useActuator:
-            toDump += [self.actuator.uprev, self.actuator.prevState]
-        info.StateData = json.dumps(toDump)
+            actuatorState.pack_into(
+                stateData,
+                stateHeader.size + engineState.size,
+                self.actuator.uprev,
+                *self.actuator.prevState
+            )
+        info.StateData = bytes(stateData)
 
     def update(self, info):
         if info.NewTimeStep and info.SimulationTime > self.lastUpdateTime: